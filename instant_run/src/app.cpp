@@ -5,6 +5,7 @@
 #include "log.h"
 #include "job_system.h"
 #include "xml.h"
+#include "search.h"
 
 #include "hook_config.h"
 
@@ -14,14 +15,22 @@
 #include <fstream>
 #include <vector>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <atomic>
 #include <unordered_map>
 #include <unordered_set>
 #include <cwctype>
+#include <algorithm>
 
 static constexpr const char* SEARCH_SCORES_FILE_PATH = "search_scores";
+static constexpr const char* QUERY_HISTORY_FILE_PATH = "query_history";
+static constexpr const char* ENTRY_INDEX_FILE_PATH = "entry_index";
 static constexpr const char* CONFIG_FILE_PATH = "config.ini";
 static constexpr int32_t MIN_WINDOW_WIDTH = 500;
 static constexpr int32_t MIN_WINDOW_HEIGHT = 300;
+static constexpr int32_t DEFAULT_SHORTCUT_RESOLVE_BATCH_SIZE = 8;
 static constexpr UVec2 INVALID_ICON_POSITION = UVec2 { UINT32_MAX, UINT32_MAX };
 
 constexpr std::wstring_view ARG_NO_HOOK = L"--no-hook";
@@ -51,34 +60,12 @@ struct Icons {
 	Rect copy;
 };
 
-struct Entry {
-	std::wstring name;
-	std::filesystem::path path;
-	std::filesystem::path resolved_path;
-
-	bool icon_is_loaded;
-	UVec2 icon;
-
-	const wchar_t* id;
-	bool is_microsoft_store_app;
-
-	uint16_t frequency_score;
-};
-
-struct ResultEntry {
-	uint32_t entry_index;
-	uint32_t score;
-
-	RangeU32 highlights;
-};
-
 struct ResultViewState {
 	uint32_t selected_index;
 	uint32_t scroll_offset;
 	uint32_t fully_visible_item_count;
 	
-	std::vector<ResultEntry> matches;
-	std::vector<RangeU32> highlights;
+	SearchResult result;
 };
 
 enum class MSStoreQueryMethod {
@@ -94,9 +81,15 @@ struct AppConfig {
 
 	// search
 	MSStoreQueryMethod ms_store_query_method;
+	int32_t parallel_search_threshold;
+	int32_t search_index_threshold;
+	float frecency_weight;
+	SearchFieldWeights search_field_weights;
 
 	// system
 	int32_t max_worker_count;
+	int32_t shortcut_resolve_batch_size;
+	bool lazy_shortcut_resolution;
 	bool disable_in_fullscreen;
 };
 
@@ -105,6 +98,81 @@ enum class AppState {
 	Sleeping,
 };
 
+struct CachedShortcut {
+	uint64_t file_write_time;
+	uint64_t file_size;
+	std::filesystem::path resolved_path;
+};
+
+// The resolved shortcuts of the previous scan by the path of the shortcut
+using ShortcutCache = std::unordered_map<std::wstring, CachedShortcut>;
+
+// The entries prepared by the `EntryUpdater`, replace the `s_app.entries` on the main thread
+struct PreparedEntries {
+	std::vector<Entry> entries;
+	SearchCorpus corpus;
+
+	// Only set when the entries were rescanned, the ids of the Microsoft Store apps are allocated in it
+	Arena id_arena;
+};
+
+// Keeps the entries up to date on a separate thread: rescans them after they were loaded from the entry index
+// or when some of the file changes were lost, and applies the changes in the walked directories.
+//
+// The search corpus of the updated entries is built on the same thread, so the main thread only swaps them in.
+struct EntryUpdater {
+	std::thread thread;
+	DirectoryWatcher* directory_watcher;
+
+	// The walked directories
+	std::vector<std::filesystem::path> roots;
+
+	Arena arena;
+	Arena temp_arena;
+
+	// Only accessed by the updater thread, the entries of the last update
+	std::vector<Entry> entries;
+	bool is_rescan_requested;
+
+	std::atomic_bool has_prepared_entries;
+	std::mutex prepared_entries_mutex;
+	PreparedEntries prepared_entries;
+	bool has_unapplied_entries;
+};
+
+struct ShortcutResolveRequest {
+	uint32_t entry_index;
+	std::filesystem::path path;
+};
+
+struct ResolvedShortcut {
+	uint32_t entry_index;
+
+	// The entries might be replaced before the result is applied, so the path of the shortcut is checked again
+	std::filesystem::path path;
+	std::filesystem::path resolved_path;
+};
+
+// Resolves the shortcuts of the entries that are about to be displayed on a separate thread,
+// when the `AppConfig::lazy_shortcut_resolution` is enabled
+struct ShortcutPrefetcher {
+	std::thread thread;
+	Arena arena;
+
+	std::mutex mutex;
+	std::condition_variable request_var;
+	bool should_stop;
+
+	// The displayed entries are at the front, followed by the top results
+	std::deque<ShortcutResolveRequest> requests;
+	std::vector<ResolvedShortcut> resolved_shortcuts;
+	std::atomic_bool has_resolved_shortcuts;
+
+	// Only accessed on the main thread
+	std::unordered_set<uint32_t> requested_entries;
+	bool has_unsaved_shortcuts;
+};
+
 struct App {
 	alignas(64) std::atomic_bool is_active;
 
@@ -130,6 +198,17 @@ struct App {
 	ui::TextInputState search_input_state;
 	ui::TextInputState lang_agnostic_search_input_state;
 	std::vector<Entry> entries;
+	EntryUpdater entry_updater;
+
+	// The ids of the Microsoft Store apps from the last rescan, the initial ones are allocated in the `arena`
+	Arena entries_id_arena;
+	ShortcutPrefetcher shortcut_prefetcher;
+	QueryHistory query_history;
+
+	// The week for which the `Entry::frecency` was computed
+	uint32_t frecency_week;
+	SearchCorpus search_corpus;
+	AsyncSearch search;
 	ResultViewState result_view_state;
 	Color highlight_color;
 };
@@ -179,121 +258,6 @@ Rect get_icon_rect(const ApplicationIconsStorage& storage, UVec2 icon_position)
 	return uv_rect;
 }
 
-//
-// Searching
-//
-
-struct SearchScore {
-	uint32_t value;
-	uint32_t highlight_range_count;
-};
-
-SearchScore compute_search_score(std::wstring_view string,
-		std::wstring_view pattern,
-		std::vector<RangeU32>& sequence_ranges) {
-	PROFILE_FUNCTION();
-
-	uint32_t highlight_count = 0;
-
-	size_t pattern_index = 0;
-
-	size_t matches = 0;
-	size_t max_substring_length = 0;
-	size_t substring_length = 0;
-	size_t substring_start = 0;
-
-	for (size_t i = 0; i < string.length() && pattern_index < pattern.length(); i++) {
-		if (substring_length == 0) {
-			substring_start = i;
-		}
-
-		if (std::towlower(string[i]) == std::towlower(pattern[pattern_index])) {
-			pattern_index += 1;
-			substring_length += 1;
-			matches += 1;
-		} else {
-			if (substring_length != 0) {
-				highlight_count += 1;
-				sequence_ranges.push_back(RangeU32 { (uint32_t)substring_start, (uint32_t)substring_length });
-			}
-
-			max_substring_length = max(max_substring_length, substring_length);
-			substring_length = 0;
-		}
-	}
-
-	if (substring_length != 0) {
-		highlight_count += 1;
-		sequence_ranges.push_back(RangeU32 { (uint32_t)substring_start, (uint32_t)substring_length });
-	}
-
-	max_substring_length = max(max_substring_length, substring_length);
-
-	return SearchScore { 
-		.value = (uint32_t)(matches + max_substring_length),
-		.highlight_range_count = highlight_count,
-	};
-}
-
-void update_search_result(std::wstring_view search_pattern,
-		std::wstring_view lang_agnostic_search_pattern,
-		const std::vector<Entry>& entries,
-		std::vector<ResultEntry>& result,
-		std::vector<RangeU32>& sequence_ranges,
-		Arena& arena) {
-	PROFILE_FUNCTION();
-
-	result.clear();
-	sequence_ranges.clear();
-
-	std::vector<RangeU32> temp_sequence_ranges;
-
-	for (size_t i = 0; i < entries.size(); i++) {
-		const Entry& entry = entries[i];
-
-		SearchScore non_lang_agnostic_score = compute_search_score(entry.name, search_pattern, temp_sequence_ranges);
-		SearchScore lang_agnostic_score = compute_search_score(entry.name, lang_agnostic_search_pattern, temp_sequence_ranges);
-
-		RangeU32 highlight_range{};
-		uint32_t final_score = 0;
-		if (non_lang_agnostic_score.value >= lang_agnostic_score.value) {
-			highlight_range.start = (uint32_t)sequence_ranges.size();
-			highlight_range.count = non_lang_agnostic_score.highlight_range_count;
-
-			final_score = non_lang_agnostic_score.value;
-
-			for (uint32_t i = 0; i < highlight_range.count; i++) {
-				sequence_ranges.push_back(temp_sequence_ranges[i]);
-			}
-		} else {
-			highlight_range.start = (uint32_t)sequence_ranges.size();
-			highlight_range.count = lang_agnostic_score.highlight_range_count;
-
-			final_score = lang_agnostic_score.value;
-
-			// highlight ranges for the language agnostic match
-			// are appended after a default (non-agnostic) ranges
-			uint32_t start = non_lang_agnostic_score.highlight_range_count;
-			for (uint32_t i = start; i < start + lang_agnostic_score.highlight_range_count; i++) {
-				sequence_ranges.push_back(temp_sequence_ranges[i]);
-			}
-		}
-
-		// The frequency_score is stored in lower half of the int,
-		// so that when the string matching scores of both entries are equal
-		// the `frequency_score` is used to prioritize the most used entry
-		final_score = ((final_score & 0xff) << 16) | ((uint32_t)(entry.frequency_score));
-
-		result.push_back({ (uint32_t)i, final_score, highlight_range });
-
-		temp_sequence_ranges.clear();
-	}
-
-	std::sort(result.begin(), result.end(), [&](auto a, auto b) -> bool {
-		return a.score > b.score;
-	});
-}
-
 //
 // Result View
 //
@@ -336,7 +300,7 @@ void draw_result_entry_text(const Entry& entry,
 
 	uint32_t cursor = 0;
 	for (uint32_t i = match.highlights.start; i < match.highlights.start + match.highlights.count; i++) {
-		RangeU32 highlight_range = state.highlights[i];
+		RangeU32 highlight_range = state.result.highlights[i];
 
 		if (cursor != highlight_range.start) {
 			text_parts[part_count] = std::wstring_view(entry.name)
@@ -413,7 +377,8 @@ EntryAction draw_result_entry(const ResultEntry& match,
 		
 		ui::add_item(Vec2 { icon_size, icon_size });
 
-		if (entry.icon != INVALID_ICON_POSITION) {
+		// The icon of an entry with a lazily resolved shortcut is not loaded until the shortcut is resolved
+		if (entry.icon_is_loaded && entry.icon != INVALID_ICON_POSITION) {
 			draw_rect(ui::get_item_bounds(), WHITE, app_icon_storage.texture, get_icon_rect(app_icon_storage, entry.icon));
 		}
 	}
@@ -472,7 +437,10 @@ EntryAction draw_result_entry(const ResultEntry& match,
 }
 
 void process_result_view_key_event(ResultViewState& state, KeyCode key, KeyModifiers modifiers) {
-	size_t result_count = state.matches.size();
+	size_t result_count = state.result.matches.size();
+	if (result_count == 0) {
+		return;
+	}
 
 	switch (key) {
 	case KeyCode::ArrowUp:
@@ -508,12 +476,37 @@ void update_result_view_scroll(ResultViewState& state) {
 	}
 }
 
+static void load_store_app_icon(ApplicationIconsStorage& app_icon_storage, Entry& entry, Arena& arena) {
+	PROFILE_FUNCTION();
+
+	entry.icon_is_loaded = true;
+	entry.icon = INVALID_ICON_POSITION;
+
+	TexturePixelData data = texture_load_pixel_data(entry.logo_uri);
+	if (!data.pixels) {
+		return;
+	}
+
+	ArenaSavePoint temp = arena_begin_temp(arena);
+	TexturePixelData downsampled = texture_downscale(data, 32, arena);
+
+	entry.icon = store_app_icon(app_icon_storage, downsampled.pixels);
+
+	texture_release_pixel_data(data);
+	arena_end_temp(temp);
+}
+
 void try_load_app_entry_icon(ApplicationIconsStorage& app_icon_storage, Entry& entry, Arena& arena) {
 	PROFILE_FUNCTION();
 	if (entry.icon_is_loaded) {
 		return;
 	}
 
+	if (entry.is_microsoft_store_app) {
+		load_store_app_icon(app_icon_storage, entry, arena);
+		return;
+	}
+
 	SystemIconHandle icon_handle = fs_query_file_icon(entry.resolved_path);
 	ApplicationIconsStorage::IconId icon_id = icon_handle;
 
@@ -538,286 +531,1506 @@ void try_load_app_entry_icon(ApplicationIconsStorage& app_icon_storage, Entry& e
 		entry.icon = icon;
 	}
 
-	fs_release_file_icon(icon_handle);
+	fs_release_file_icon(icon_handle);
+
+	arena_end_temp(temp_region);
+	entry.icon_is_loaded = true;
+}
+
+void enable_app() {
+	PROFILE_FUNCTION();
+
+	log_info(L"recieved activation notification from the keyboard hook");
+
+	if (s_app.config.disable_in_fullscreen && platform_has_running_fullscreen_app()) {
+		log_info(L"ignoring activation notification: a fullscreen application is running");
+		return;
+	}
+
+	s_app.enable_var.notify_all();
+	s_app.is_active.store(true, std::memory_order::acquire);
+}
+
+// Waits for the hook to notify about the activation
+void wait_for_activation() {
+	if (!s_app.use_keyboard_hook) {
+		s_app.state = AppState::Running;
+		return;
+	}
+
+	// Can happen that the hook notifies before this function is called
+	bool is_already_active = s_app.is_active.load(std::memory_order::relaxed);
+	if (is_already_active) {
+		log_info(L"already activated");
+	} else {
+		log_info(L"waiting for activation");
+		std::unique_lock lock(s_app.enable_mutex);
+		s_app.enable_var.wait(lock);
+	}
+
+	// The app was activated
+	s_app.state = AppState::Running;
+}
+
+void enter_sleep_mode() {
+	if (!s_app.use_keyboard_hook) {
+		window_close(*s_app.window);
+		return;
+	}
+
+	log_info(L"entering sleep mode");
+	s_app.is_active.store(false, std::memory_order::acquire);
+	wait_for_activation();
+}
+
+//
+// Keyboard Hook
+//
+
+bool init_keyboard_hook(Arena& allocator) {
+	PROFILE_FUNCTION();
+	HookConfig config{};
+	config.app_enable_fn = enable_app;
+	s_app.keyboard_hook = keyboard_hook_init(allocator, config);
+
+	return s_app.keyboard_hook != nullptr;
+}
+
+void shutdown_keyboard_hook() {
+	keyboard_hook_shutdown(s_app.keyboard_hook);
+}
+
+//
+// Search Entries
+//
+
+static void resolve_entry_shortcut(Entry& entry) {
+	if (entry.path.extension() == ".lnk") {
+		entry.resolved_path = fs_resolve_shortcut(entry.path);
+	} else {
+		entry.resolved_path = entry.path;
+	}
+}
+
+// Resolves a batch of `Entry*`
+void resolve_shortcuts_task(const JobContext& context, void* data) {
+	PROFILE_FUNCTION();
+
+	Span<Entry*> entries = Span(reinterpret_cast<Entry**>(data), context.batch_size);
+	for (Entry* entry : entries) {
+		resolve_entry_shortcut(*entry);
+	}
+}
+
+static ShortcutCache create_shortcut_cache(const std::vector<Entry>& entries) {
+	PROFILE_FUNCTION();
+
+	ShortcutCache cache;
+	for (const Entry& entry : entries) {
+		if (!entry.is_microsoft_store_app && entry.path.extension() == ".lnk") {
+			cache.emplace(entry.path.wstring(), CachedShortcut {
+				.file_write_time = entry.file_write_time,
+				.file_size = entry.file_size,
+				.resolved_path = entry.resolved_path,
+			});
+		}
+	}
+
+	return cache;
+}
+
+// Returns `true` if the shortcut didn't change since it was cached
+static bool try_resolve_cached_shortcut(const ShortcutCache& cache, Entry& entry) {
+	auto it = cache.find(entry.path.wstring());
+	if (it == cache.end()) {
+		return false;
+	}
+
+	// The shortcut was not resolved when the resolution is lazy
+	const CachedShortcut& cached_shortcut = it->second;
+	if (cached_shortcut.resolved_path.empty()) {
+		return false;
+	}
+
+	if (cached_shortcut.file_write_time != entry.file_write_time || cached_shortcut.file_size != entry.file_size) {
+		return false;
+	}
+
+	entry.resolved_path = cached_shortcut.resolved_path;
+	return true;
+}
+
+// The file time is only compared for equality, so the clock doesn't matter
+static uint64_t get_file_write_time(const std::filesystem::directory_entry& file) {
+	std::error_code error;
+	return (uint64_t)file.last_write_time(error).time_since_epoch().count();
+}
+
+static uint64_t get_file_size(const std::filesystem::directory_entry& file) {
+	std::error_code error;
+	uint64_t size = (uint64_t)file.file_size(error);
+	return error ? 0 : size;
+}
+
+struct WalkedFile {
+	// Index of the walked root directory
+	uint32_t root_index;
+	std::filesystem::path path;
+
+	uint64_t write_time;
+	uint64_t size;
+};
+
+struct DirectoryWalk {
+	// One list and one arena per job system worker and one for the thread waiting for the jobs,
+	// so the workers append and submit the jobs without locking
+	std::vector<std::vector<WalkedFile>> worker_files;
+	std::vector<Arena> worker_job_arenas;
+
+	JobGroup job_group;
+};
+
+// Allocated in the `DirectoryWalk::worker_job_arenas` of the submitting thread, which are released after the walk
+struct DirectoryWalkJob {
+	DirectoryWalk* walk;
+	uint32_t root_index;
+	std::wstring_view path;
+};
+
+static void walk_directory_task(const JobContext& context, void* data);
+
+static void submit_directory_walk_job(DirectoryWalk& walk,
+		uint32_t submitting_worker_index,
+		uint32_t root_index,
+		const std::filesystem::path& path) {
+	Arena& arena = walk.worker_job_arenas[submitting_worker_index];
+
+	DirectoryWalkJob* job = arena_alloc<DirectoryWalkJob>(arena);
+	job->walk = &walk;
+	job->root_index = root_index;
+	job->path = arena_push_string(arena, path.wstring());
+
+	job_system_submit(&walk.job_group, walk_directory_task, job);
+}
+
+// Lists a single directory, every subdirectory is walked by a separate job
+static void walk_directory_task(const JobContext& context, void* data) {
+	PROFILE_FUNCTION();
+
+	const DirectoryWalkJob* job = reinterpret_cast<const DirectoryWalkJob*>(data);
+	std::vector<WalkedFile>& files = job->walk->worker_files[context.worker_index];
+
+	std::error_code error;
+	std::filesystem::path path(job->path);
+	std::filesystem::directory_iterator iterator(path, std::filesystem::directory_options::skip_permission_denied, error);
+
+	for (; !error && iterator != std::filesystem::directory_iterator(); iterator.increment(error)) {
+		const std::filesystem::directory_entry& child = *iterator;
+
+		// NOTE: The type is cached from the directory listing, so unlike `std::filesystem::is_directory(path)`
+		// this doesn't query the file system again, except for the symlinks.
+		std::error_code type_error;
+		if (child.is_directory(type_error)) {
+			submit_directory_walk_job(*job->walk, context.worker_index, job->root_index, child.path());
+		} else {
+			// NOTE: The write time and the size are cached from the directory listing on Windows
+			files.push_back(WalkedFile {
+				.root_index = job->root_index,
+				.path = child.path(),
+				.write_time = get_file_write_time(child),
+				.size = get_file_size(child),
+			});
+		}
+	}
+
+	if (error) {
+		log_error(L"failed to walk directory: " + path.wstring());
+	}
+}
+
+// Walks the `roots` on the job system and appends an entry for every file, skipping the files whose name was already used.
+void walk_directories(const std::vector<std::filesystem::path>& roots,
+		std::vector<Entry>& entries,
+		Arena& arena,
+		Arena& temp_arena) {
+	PROFILE_FUNCTION();
+
+	uint32_t waiting_worker_index = job_system_get_worker_count();
+
+	DirectoryWalk walk{};
+	walk.worker_files.resize(waiting_worker_index + 1);
+	walk.worker_job_arenas.resize(waiting_worker_index + 1);
+
+	for (Arena& job_arena : walk.worker_job_arenas) {
+		job_arena.capacity = mb_to_bytes(8);
+	}
+
+	for (uint32_t i = 0; i < (uint32_t)roots.size(); i++) {
+		submit_directory_walk_job(walk, waiting_worker_index, i, roots[i]);
+	}
+
+	job_system_wait_for_group(walk.job_group, arena, temp_arena);
+
+	for (Arena& job_arena : walk.worker_job_arenas) {
+		arena_release(job_arena);
+	}
+
+	std::vector<WalkedFile> files;
+	{
+		PROFILE_SCOPE("merge_worker_files");
+
+		size_t file_count = 0;
+		for (const std::vector<WalkedFile>& worker_files : walk.worker_files) {
+			file_count += worker_files.size();
+		}
+
+		files.reserve(file_count);
+		for (std::vector<WalkedFile>& worker_files : walk.worker_files) {
+			std::move(worker_files.begin(), worker_files.end(), std::back_inserter(files));
+		}
+
+		// The jobs complete in any order, so the files are sorted to make the kept one of the files
+		// with the same name independent of the scheduling. Within a root, sorting by the path
+		// gives the same order as a recursive walk that lists the directories alphabetically.
+		std::sort(files.begin(), files.end(), [](const WalkedFile& a, const WalkedFile& b) {
+			if (a.root_index != b.root_index) {
+				return a.root_index < b.root_index;
+			}
+
+			return a.path < b.path;
+		});
+	}
+
+	ArenaSavePoint temp = arena_begin_temp(temp_arena);
+
+	std::unordered_set<std::wstring_view> used_app_names;
+	for (WalkedFile& file : files) {
+		std::wstring application_name = file.path.filename().replace_extension("").wstring();
+		std::wstring_view lower_application_name = wstr_to_lower(application_name, temp_arena);
+
+		if (used_app_names.contains(lower_application_name)) {
+			continue;
+		}
+
+		Entry& entry = entries.emplace_back();
+		entry.name = std::move(application_name);
+		entry.path = std::move(file.path);
+		entry.file_write_time = file.write_time;
+		entry.file_size = file.size;
+
+		used_app_names.emplace(lower_application_name);
+	}
+
+	arena_end_temp(temp);
+}
+
+// Every line contains the week of the last launch, followed by the launch counts in each bucket and the name of the entry:
+// `<last_launch_week> <count 0> ... <count N - 1> "<name>"`
+//
+// The older format only stored the total launch count: `<launch_count> "<name>"`
+void serialize_launch_histories(Span<const Entry> entries) {
+	PROFILE_FUNCTION();
+	std::wofstream file(s_app.app_data_dir_path / SEARCH_SCORES_FILE_PATH);
+	for (const auto& entry : entries) {
+		const LaunchHistory& history = entry.launch_history;
+		if (history.last_launch_week == 0) {
+			continue;
+		}
+
+		file << history.last_launch_week;
+		for (uint32_t i = 0; i < LAUNCH_HISTORY_BUCKET_COUNT; i++) {
+			file << L' ' << (uint32_t)history.bucket_counts[i];
+		}
+
+		file << " \"" << entry.name << "\"\n";
+	}
+}
+
+// Reads the whole file from the app data directory into the `arena`
+static bool read_app_data_file(const char* file_path, Arena& arena, std::wstring_view* out_content) {
+	PROFILE_FUNCTION();
+
+	std::wifstream stream(s_app.app_data_dir_path / file_path);
+	if (!stream.is_open()) {
+		return false;
+	}
+
+	stream.seekg(0, std::ios::end);
+	size_t size = stream.tellg();
+	stream.seekg(0, std::ios::beg);
+
+	wchar_t* buffer = arena_alloc_array<wchar_t>(arena, size + 1);
+	buffer[size] = 0;
+
+	stream.read(buffer, size);
+
+	*out_content = std::wstring_view(buffer, size);
+	return true;
+}
+
+// Parses a single `<number> ... <number> "<name>"` line, the format of the files with the per entry data.
+//
+// Moves the `read_position` to the start of the next line, returns `false` if the line is malformed.
+static bool parse_entry_data_line(std::wstring_view file_content,
+		size_t& read_position,
+		Span<uint64_t> out_numbers,
+		uint32_t* out_number_count,
+		std::wstring_view* out_name) {
+	uint32_t number_count = 0;
+
+	while (number_count < out_numbers.count
+			&& read_position < file_content.size()
+			&& file_content[read_position] >= L'0'
+			&& file_content[read_position] <= L'9') {
+		uint64_t value = 0;
+		while (read_position < file_content.size()
+				&& file_content[read_position] >= L'0'
+				&& file_content[read_position] <= L'9') {
+
+			uint64_t digit = file_content[read_position] - L'0';
+			value *= 10;
+			value += digit;
+
+			read_position += 1;
+		}
+
+		out_numbers[number_count] = value;
+		number_count += 1;
+
+		// Skip the separator, unless the name follows
+		if (read_position + 1 < file_content.size()
+				&& file_content[read_position] == L' '
+				&& file_content[read_position + 1] != L'"') {
+			read_position += 1;
+		}
+	}
+
+	// Parse the rest of the line
+	size_t after_numbers_position = read_position;
+	while (read_position < file_content.size() && file_content[read_position] != '\n') {
+		read_position += 1;
+	}
+
+	size_t name_start = after_numbers_position + 2;
+	size_t name_end = read_position - 1;
+	bool is_valid = name_start < file_content.size()
+		&& name_start < name_end
+		&& number_count != 0
+		&& file_content[after_numbers_position] == L' '
+		&& file_content[after_numbers_position + 1] == L'"'
+		&& file_content[read_position - 1] == L'"';
+
+	read_position += 1; // skip new line char
+
+	if (!is_valid) {
+		return false;
+	}
+
+	*out_number_count = number_count;
+	*out_name = file_content.substr(name_start, name_end - name_start);
+	return true;
+}
+
+bool deserialize_launch_histories(Span<Entry> entries, Arena& arena) {
+	PROFILE_FUNCTION();
+
+	ArenaSavePoint temp = arena_begin_temp(arena);
+
+	std::wstring_view file_content;
+	if (!read_app_data_file(SEARCH_SCORES_FILE_PATH, arena, &file_content)) {
+		arena_end_temp(temp);
+		return false;
+	}
+
+	std::unordered_map<std::wstring_view, LaunchHistory> app_name_to_history;
+
+	uint32_t current_week = launch_history_get_current_week();
+
+	constexpr uint32_t MAX_LINE_NUMBER_COUNT = LAUNCH_HISTORY_BUCKET_COUNT + 1;
+
+	size_t read_position = 0;
+	while (read_position < file_content.size()) {
+		uint64_t numbers[MAX_LINE_NUMBER_COUNT] = {};
+		uint32_t number_count = 0;
+		std::wstring_view application_name;
+
+		if (!parse_entry_data_line(file_content, read_position, Span(numbers, MAX_LINE_NUMBER_COUNT), &number_count, &application_name)
+				|| (number_count != 1 && number_count != MAX_LINE_NUMBER_COUNT)) {
+			continue;
+		}
+
+		LaunchHistory history{};
+		if (number_count == 1) {
+			// NOTE: The old format didn't store when the app was launched,
+			//       so the launches are treated as if they happened a month ago.
+			launch_history_record_launch(history, current_week - 4, (uint32_t)min(numbers[0], (size_t)UINT32_MAX));
+		} else {
+			history.last_launch_week = (uint32_t)numbers[0];
+			for (uint32_t i = 0; i < LAUNCH_HISTORY_BUCKET_COUNT; i++) {
+				history.bucket_counts[i] = (uint8_t)min(numbers[i + 1], (size_t)UINT8_MAX);
+			}
+		}
+
+		app_name_to_history.emplace(application_name, history);
+	}
+
+	for (auto& entry : entries) {
+		auto it = app_name_to_history.find(entry.name);
+		if (it == app_name_to_history.end()) {
+			continue;
+		}
+
+		entry.launch_history = it->second;
+	}
+
+	arena_end_temp(temp);
+
+	return true;
+}
+
+// Every line contains a single association of the query history:
+// `<prefix_hash> <launch_count> <last_launch> "<name>"`
+void serialize_query_history(const QueryHistory& history, Span<const Entry> entries) {
+	PROFILE_FUNCTION();
+	std::wofstream file(s_app.app_data_dir_path / QUERY_HISTORY_FILE_PATH);
+	for (const QueryHistorySlot& slot : history.slots) {
+		if (slot.launch_count == 0) {
+			continue;
+		}
+
+		file << slot.prefix_hash
+			<< L' ' << slot.launch_count
+			<< L' ' << slot.last_launch
+			<< " \"" << entries[slot.entry_index].name << "\"\n";
+	}
+}
+
+bool deserialize_query_history(QueryHistory& history, Span<const Entry> entries, Arena& arena) {
+	PROFILE_FUNCTION();
+
+	ArenaSavePoint temp = arena_begin_temp(arena);
+
+	std::wstring_view file_content;
+	if (!read_app_data_file(QUERY_HISTORY_FILE_PATH, arena, &file_content)) {
+		arena_end_temp(temp);
+		return false;
+	}
+
+	std::unordered_map<std::wstring_view, uint32_t> app_name_to_entry_index;
+	for (uint32_t i = 0; i < entries.count; i++) {
+		app_name_to_entry_index.emplace(entries[i].name, i);
+	}
+
+	constexpr uint32_t LINE_NUMBER_COUNT = 3;
+
+	size_t read_position = 0;
+	while (read_position < file_content.size()) {
+		uint64_t numbers[LINE_NUMBER_COUNT] = {};
+		uint32_t number_count = 0;
+		std::wstring_view application_name;
+
+		if (!parse_entry_data_line(file_content, read_position, Span(numbers, LINE_NUMBER_COUNT), &number_count, &application_name)
+				|| number_count != LINE_NUMBER_COUNT) {
+			continue;
+		}
+
+		// The entries of the apps that were uninstalled are dropped
+		auto it = app_name_to_entry_index.find(application_name);
+		if (it == app_name_to_entry_index.end()) {
+			continue;
+		}
+
+		QueryHistorySlot slot{};
+		slot.prefix_hash = numbers[0];
+		slot.entry_index = it->second;
+		slot.launch_count = (uint32_t)min(numbers[1], (size_t)UINT32_MAX);
+		slot.last_launch = (uint32_t)min(numbers[2], (size_t)UINT32_MAX);
+
+		query_history_restore_slot(history, slot);
+	}
+
+	arena_end_temp(temp);
+
+	return true;
+}
+
+// Applies the decay of the launch histories, done on activation rather than during the search.
+// The decay only changes once a week, the launched entries are updated right away.
+//
+// Returns `true` if the frecency of the entries was updated.
+//
+// The search reads its own copy of the frecency, so the changes have to be posted to it afterwards.
+bool update_frecency_scores() {
+	uint32_t current_week = launch_history_get_current_week();
+	if (current_week == s_app.frecency_week) {
+		return false;
+	}
+
+	PROFILE_FUNCTION();
+
+	s_app.frecency_week = current_week;
+	for (Entry& entry : s_app.entries) {
+		if (entry.launch_history.last_launch_week != 0) {
+			entry.frecency = launch_history_compute_frecency(entry.launch_history, current_week);
+		}
+	}
+
+	return true;
+}
+
+struct SearchEntriesQuery {
+	std::vector<Entry> entries;
+
+	// The entries with the shortcuts which have to be resolved by the jobs
+	std::vector<Entry*> unresolved_entries;
+	JobGroup shortcut_job_group;
+
+	InstalledAppsQueryState* installed_apps_query;
+};
+
+// The directories which are walked for the entries
+static std::vector<std::filesystem::path> get_entry_directory_paths() {
+	return fs_get_known_folder_paths(KnownFolderKind::Desktop | KnownFolderKind::StartMenu | KnownFolderKind::Programs);
+}
+
+// The `temp_arena` must not be cleared until the `collect_search_entries_query_result` has completed.
+// The shortcuts that are in the `shortcut_cache` and haven't changed are not resolved again, it can be `nullptr`.
+void schedule_search_entries_query(SearchEntriesQuery& query_state,
+		Arena& arena,
+		Arena& temp_arena,
+		const ShortcutCache* shortcut_cache) {
+	PROFILE_FUNCTION();
+
+	walk_directories(get_entry_directory_paths(), query_state.entries, arena, temp_arena);
+
+	{
+		PROFILE_SCOPE("lookup_cached_shortcuts");
+
+		for (Entry& entry : query_state.entries) {
+			if (entry.path.extension() != ".lnk") {
+				entry.resolved_path = entry.path;
+				continue;
+			}
+
+			if (shortcut_cache != nullptr && try_resolve_cached_shortcut(*shortcut_cache, entry)) {
+				continue;
+			}
+
+			// Otherwise resolved by the `ShortcutPrefetcher` once the entry is about to be displayed
+			if (!s_app.config.lazy_shortcut_resolution) {
+				query_state.unresolved_entries.push_back(&entry);
+			}
+		}
+	}
+
+	// Resolving a shortcut is slow, so they are split into batches that are resolved in parallel
+	job_system_submit_batches(&query_state.shortcut_job_group,
+			resolve_shortcuts_task,
+			Span<Entry*>(query_state.unresolved_entries.data(), query_state.unresolved_entries.size()),
+			(size_t)s_app.config.shortcut_resolve_batch_size);
+
+	query_state.installed_apps_query = platform_begin_installed_apps_query(temp_arena,
+			s_app.config.ms_store_query_method == MSStoreQueryMethod::Experimental);
+}
+
+void collect_search_entries_query_result(Arena& arena, Arena& temp_arena, SearchEntriesQuery& query_state) {
+	PROFILE_FUNCTION();
+
+	job_system_wait_for_group(query_state.shortcut_job_group, arena, temp_arena);
+
+	std::vector<InstalledAppDesc> installed_apps = platform_finish_installed_apps_query(
+			query_state.installed_apps_query,
+			arena,
+			temp_arena);
+
+	std::vector<Entry>& entries = query_state.entries;
+
+	// NOTE: The `unresolved_entries` point into the `entries`, which are reallocated below
+	query_state.unresolved_entries.clear();
+	entries.reserve(entries.size() + installed_apps.size());
+
+	// The icons are loaded when the entries are displayed
+	for (const auto& app_desc : installed_apps) {
+		Entry& entry = entries.emplace_back();
+		entry.name = app_desc.display_name;
+		entry.is_microsoft_store_app = true;
+		entry.icon = INVALID_ICON_POSITION;
+		entry.id = app_desc.id;
+		entry.logo_uri = app_desc.logo_uri;
+	}
+
+	{
+		ArenaSavePoint temp = arena_begin_temp(arena);
+		StringBuilder<wchar_t> builder = { &arena };
+		str_builder_append<wchar_t>(builder, L"loaded ");
+		str_builder_append<wchar_t>(builder, std::to_wstring(entries.size()));
+		str_builder_append<wchar_t>(builder, L" entries");
+
+		log_info(str_builder_to_str(builder));
+		arena_end_temp(temp);
+	}
+
+}
+
+//
+// Entry Index
+//
+
+// Binary snapshot of the entries, which is memory mapped at startup, so that the entries are searchable
+// before the file system is walked, the shortcuts are resolved and the installed apps are queried.
+//
+// Layout: `EntryIndexHeader`, `entry_count` of `EntryIndexRecord`, then `char_count` of `wchar_t` with all the strings.
+static constexpr uint32_t ENTRY_INDEX_MAGIC = 0x58444e49; // "INDX"
+
+// Must be incremented after changing the layout, the indices of the older versions are ignored
+static constexpr uint32_t ENTRY_INDEX_VERSION = 2;
+
+struct EntryIndexHeader {
+	uint32_t magic;
+	uint32_t version;
+
+	// The size of the `wchar_t` differs between the platforms
+	uint32_t char_size;
+
+	uint32_t entry_count;
+	uint32_t char_count;
+};
+
+struct EntryIndexString {
+	uint32_t offset;
+	uint32_t length;
+};
+
+struct EntryIndexRecord {
+	uint64_t file_write_time;
+	uint64_t file_size;
+
+	EntryIndexString name;
+	EntryIndexString path;
+	EntryIndexString resolved_path;
+
+	// Only the Microsoft Store apps have an id and a logo
+	EntryIndexString id;
+	EntryIndexString logo_uri;
+
+	uint32_t is_microsoft_store_app;
+};
+
+static EntryIndexString append_entry_index_string(std::vector<wchar_t>& chars, std::wstring_view string) {
+	EntryIndexString index_string = EntryIndexString { (uint32_t)chars.size(), (uint32_t)string.length() };
+	chars.insert(chars.end(), string.begin(), string.end());
+	return index_string;
+}
+
+void serialize_entry_index(Span<const Entry> entries) {
+	PROFILE_FUNCTION();
+
+	std::vector<EntryIndexRecord> records(entries.count);
+	std::vector<wchar_t> chars;
+
+	for (size_t i = 0; i < entries.count; i++) {
+		const Entry& entry = entries[i];
+		EntryIndexRecord& record = records[i];
+
+		record.name = append_entry_index_string(chars, entry.name);
+		record.path = append_entry_index_string(chars, entry.path.wstring());
+		record.resolved_path = append_entry_index_string(chars, entry.resolved_path.wstring());
+		record.id = append_entry_index_string(chars, entry.id != nullptr ? std::wstring_view(entry.id) : std::wstring_view());
+		record.logo_uri = append_entry_index_string(chars, entry.logo_uri);
+		record.is_microsoft_store_app = entry.is_microsoft_store_app;
+		record.file_write_time = entry.file_write_time;
+		record.file_size = entry.file_size;
+	}
+
+	EntryIndexHeader header = EntryIndexHeader {
+		.magic = ENTRY_INDEX_MAGIC,
+		.version = ENTRY_INDEX_VERSION,
+		.char_size = (uint32_t)sizeof(wchar_t),
+		.entry_count = (uint32_t)records.size(),
+		.char_count = (uint32_t)chars.size(),
+	};
+
+	// Written into a temporary file which then replaces the index, so that the index is never partially written
+	std::filesystem::path index_path = s_app.app_data_dir_path / ENTRY_INDEX_FILE_PATH;
+	std::filesystem::path temp_index_path = index_path;
+	temp_index_path += ".tmp";
+
+	{
+		std::ofstream file(temp_index_path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(records.data()), sizeof(EntryIndexRecord) * records.size());
+		file.write(reinterpret_cast<const char*>(chars.data()), sizeof(wchar_t) * chars.size());
+
+		if (!file) {
+			log_error(L"failed to write the entry index");
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temp_index_path, index_path, error);
+	if (error) {
+		log_error(L"failed to replace the entry index");
+	}
+}
+
+static bool get_entry_index_string(const EntryIndexHeader& header,
+		const wchar_t* chars,
+		EntryIndexString string,
+		std::wstring_view* out_string) {
+	if (string.offset > header.char_count || string.length > header.char_count - string.offset) {
+		return false;
+	}
+
+	*out_string = std::wstring_view(chars + string.offset, string.length);
+	return true;
+}
+
+static bool read_entry_index(const MappedFile& file, std::vector<Entry>& out_entries, Arena& arena) {
+	if (file.size < sizeof(EntryIndexHeader)) {
+		return false;
+	}
+
+	EntryIndexHeader header{};
+	std::memcpy(&header, file.data, sizeof(header));
+
+	if (header.magic != ENTRY_INDEX_MAGIC || header.version != ENTRY_INDEX_VERSION || header.char_size != sizeof(wchar_t)) {
+		return false;
+	}
+
+	size_t expected_size = sizeof(EntryIndexHeader)
+		+ sizeof(EntryIndexRecord) * (size_t)header.entry_count
+		+ sizeof(wchar_t) * (size_t)header.char_count;
+
+	if (file.size != expected_size) {
+		return false;
+	}
+
+	// NOTE: The header is made of `uint32_t` and the size of a record is a multiple of 8, so the chars are aligned,
+	// while the records are not, because the header is 4 bytes short of the alignment of the `uint64_t`.
+	const uint8_t* records = file.data + sizeof(EntryIndexHeader);
+	const wchar_t* chars = reinterpret_cast<const wchar_t*>(records + sizeof(EntryIndexRecord) * header.entry_count);
+
+	out_entries.resize(header.entry_count);
+	for (uint32_t i = 0; i < header.entry_count; i++) {
+		EntryIndexRecord record{};
+		std::memcpy(&record, records + sizeof(EntryIndexRecord) * i, sizeof(record));
+
+		std::wstring_view name;
+		std::wstring_view path;
+		std::wstring_view resolved_path;
+		std::wstring_view id;
+		std::wstring_view logo_uri;
+
+		bool are_strings_valid = get_entry_index_string(header, chars, record.name, &name)
+			&& get_entry_index_string(header, chars, record.path, &path)
+			&& get_entry_index_string(header, chars, record.resolved_path, &resolved_path)
+			&& get_entry_index_string(header, chars, record.id, &id)
+			&& get_entry_index_string(header, chars, record.logo_uri, &logo_uri);
+
+		if (!are_strings_valid) {
+			return false;
+		}
+
+		Entry& entry = out_entries[i];
+		entry.name = name;
+		entry.path = path;
+		entry.resolved_path = resolved_path;
+		entry.logo_uri = logo_uri;
+		entry.is_microsoft_store_app = record.is_microsoft_store_app != 0;
+		entry.file_write_time = record.file_write_time;
+		entry.file_size = record.file_size;
+		entry.icon = INVALID_ICON_POSITION;
+
+		if (!id.empty()) {
+			// Launching expects a null-terminated id
+			wchar_t* id_copy = arena_alloc_array<wchar_t>(arena, id.length() + 1);
+			std::memcpy(id_copy, id.data(), sizeof(wchar_t) * id.length());
+			id_copy[id.length()] = L'\0';
+
+			entry.id = id_copy;
+		}
+	}
+
+	return true;
+}
+
+// Returns `false` if there is no index or it is invalid, then the entries have to be scanned
+bool deserialize_entry_index(std::vector<Entry>& out_entries, Arena& arena) {
+	PROFILE_FUNCTION();
+
+	MappedFile file{};
+	if (!fs_map_file(s_app.app_data_dir_path / ENTRY_INDEX_FILE_PATH, &file)) {
+		return false;
+	}
+
+	bool is_valid = read_entry_index(file, out_entries, arena);
+	fs_unmap_file(file);
+
+	if (!is_valid) {
+		log_warn(L"the entry index is invalid or outdated");
+		out_entries.clear();
+	}
+
+	return is_valid;
+}
+
+static bool are_entries_equal(const std::vector<Entry>& a, const std::vector<Entry>& b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < a.size(); i++) {
+		std::wstring_view a_id = a[i].id != nullptr ? std::wstring_view(a[i].id) : std::wstring_view();
+		std::wstring_view b_id = b[i].id != nullptr ? std::wstring_view(b[i].id) : std::wstring_view();
+
+		bool is_equal = a[i].name == b[i].name
+			&& a[i].path == b[i].path
+			&& a[i].resolved_path == b[i].resolved_path
+			&& a[i].file_write_time == b[i].file_write_time
+			&& a[i].file_size == b[i].file_size
+			&& a[i].is_microsoft_store_app == b[i].is_microsoft_store_app
+			&& a_id == b_id
+			&& a[i].logo_uri == b[i].logo_uri;
+
+		if (!is_equal) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Called on the search thread
+static void on_search_result_ready(void* user_data) {
+	window_wake_up(s_app.window);
+}
+
+void clear_search_result() {
+	PROFILE_FUNCTION();
+
+	ui::text_input_state_clear(s_app.search_input_state);
+	ui::text_input_state_clear(s_app.lang_agnostic_search_input_state);
+	async_search_post_query(s_app.search, {}, {});
+}
+
+// Builds the corpus of the `entries` and its index, if there are enough entries for it
+static void build_search_corpus(SearchCorpus& corpus, const std::vector<Entry>& entries, Arena& arena, Arena& temp_arena) {
+	PROFILE_FUNCTION();
+
+	const AppConfig& app_config = s_app.config;
+	search_corpus_build(corpus, entries, app_config.search_field_weights);
+
+	if (corpus.entry_count >= (uint32_t)app_config.search_index_threshold) {
+		search_corpus_build_index(corpus, arena, temp_arena);
+	}
+}
+
+// Starts the search over the `s_app.entries` and the `s_app.search_corpus`
+static void start_search() {
+	PROFILE_FUNCTION();
+
+	const AppConfig& app_config = s_app.config;
+	async_search_start(s_app.search,
+			s_app.entries,
+			s_app.search_corpus,
+			&s_app.query_history,
+			(uint32_t)app_config.parallel_search_threshold,
+			app_config.frecency_weight,
+			on_search_result_ready,
+			nullptr);
+}
+
+//
+// Entry Updater
+//
+
+// The changes are applied once there were no more changes for this long,
+// so that an installer that creates many files doesn't update the entries after every one of them
+static constexpr uint32_t ENTRY_UPDATER_BATCH_DELAY_MS = 500;
+
+struct EntryUpdate {
+	// The entries inside of the removed directories are removed too
+	std::vector<std::filesystem::path> removed_paths;
+
+	// Already have the shortcuts resolved
+	std::vector<Entry> added_entries;
+
+	// Some of the changes were lost, so the entries have to be rescanned
+	bool requires_rescan;
+};
+
+static void append_entry_for_file(const std::filesystem::directory_entry& file, std::vector<Entry>& entries) {
+	Entry& entry = entries.emplace_back();
+	entry.name = file.path().filename().replace_extension("").wstring();
+	entry.path = file.path();
+	entry.file_write_time = get_file_write_time(file);
+	entry.file_size = get_file_size(file);
+
+	resolve_entry_shortcut(entry);
+}
+
+// Appends the entries for the added file or all the files inside of the added directory
+static void append_added_entries(const std::filesystem::path& path, std::vector<Entry>& entries) {
+	// The file might have been removed again before the batch was prepared
+	std::error_code error;
+	std::filesystem::directory_entry file(path, error);
+	if (error || !file.exists(error)) {
+		return;
+	}
+
+	if (!file.is_directory(error)) {
+		append_entry_for_file(file, entries);
+		return;
+	}
+
+	std::filesystem::recursive_directory_iterator iterator(path, std::filesystem::directory_options::skip_permission_denied, error);
+	for (; !error && iterator != std::filesystem::recursive_directory_iterator(); iterator.increment(error)) {
+		std::error_code type_error;
+		if (!iterator->is_directory(type_error)) {
+			append_entry_for_file(*iterator, entries);
+		}
+	}
+}
+
+static void prepare_entry_update(Span<FileChange> changes, EntryUpdate& update) {
+	PROFILE_FUNCTION();
+
+	for (FileChange& change : changes) {
+		switch (change.kind) {
+		case FileChangeKind::Added:
+			append_added_entries(change.path, update.added_entries);
+			break;
+		case FileChangeKind::Removed:
+			update.removed_paths.push_back(std::move(change.path));
+			break;
+		case FileChangeKind::Renamed:
+			update.removed_paths.push_back(std::move(change.old_path));
+			append_added_entries(change.path, update.added_entries);
+			break;
+		case FileChangeKind::Overflowed:
+			update.requires_rescan = true;
+			break;
+		}
+	}
+}
+
+// Also checks the parent directories, because removing a directory only reports the directory itself
+static bool is_entry_path_removed(const std::filesystem::path& path, const std::unordered_set<std::wstring>& removed_paths) {
+	for (std::filesystem::path current = path; current.has_relative_path(); current = current.parent_path()) {
+		if (removed_paths.contains(current.wstring())) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// The index of the first root that contains the `path`, which is the one it was walked from.
+// The roots can be nested, then the files are walked from each of them.
+static uint32_t find_walked_root_index(const std::vector<std::filesystem::path>& roots, const std::filesystem::path& path) {
+	for (uint32_t i = 0; i < (uint32_t)roots.size(); i++) {
+		auto [root_it, path_it] = std::mismatch(roots[i].begin(), roots[i].end(), path.begin(), path.end());
+		if (root_it == roots[i].end()) {
+			return i;
+		}
+	}
+
+	return (uint32_t)roots.size();
+}
+
+// Builds the search corpus of the updated entries, rewrites the entry index and passes them to the main thread.
+//
+// The `id_arena` is only set when the entries were rescanned, the ids of the Microsoft Store apps are allocated in it.
+static void post_updated_entries(EntryUpdater& updater, std::vector<Entry> entries, Arena id_arena) {
+	PROFILE_FUNCTION();
+
+	PreparedEntries prepared{};
+	prepared.id_arena = id_arena;
+
+	build_search_corpus(prepared.corpus, entries, updater.arena, updater.temp_arena);
+	arena_reset(updater.temp_arena);
+
+	serialize_entry_index(Span<const Entry>(entries.data(), entries.size()));
+
+	updater.entries = entries;
+	prepared.entries = std::move(entries);
+
+	{
+		std::lock_guard lock(updater.prepared_entries_mutex);
+
+		// The previous entries might not be applied yet, because the app was sleeping
+		if (updater.has_unapplied_entries) {
+			PreparedEntries& unapplied = updater.prepared_entries;
+			search_corpus_release(unapplied.corpus);
+
+			// NOTE: The entries that were updated without a rescan still refer to the ids in the arena of the previous ones
+			if (prepared.id_arena.capacity == 0) {
+				prepared.id_arena = unapplied.id_arena;
+			} else {
+				arena_release(unapplied.id_arena);
+			}
+		}
+
+		updater.prepared_entries = std::move(prepared);
+		updater.has_unapplied_entries = true;
+	}
+
+	updater.has_prepared_entries.store(true, std::memory_order::release);
+	window_wake_up(s_app.window);
+}
+
+static void rescan_entries(EntryUpdater& updater) {
+	PROFILE_FUNCTION();
+
+	// Every rescan gets its own arena for the ids, which is released once the main thread replaces the entries that refer to it
+	Arena id_arena { .capacity = mb_to_bytes(8) };
+
+	ShortcutCache shortcut_cache = create_shortcut_cache(updater.entries);
+
+	SearchEntriesQuery query{};
+	schedule_search_entries_query(query, id_arena, updater.temp_arena, &shortcut_cache);
+	collect_search_entries_query_result(id_arena, updater.temp_arena, query);
+	arena_reset(updater.temp_arena);
+
+	if (are_entries_equal(updater.entries, query.entries)) {
+		log_info(L"the entry index is up to date");
+		arena_release(id_arena);
+		return;
+	}
+
+	post_updated_entries(updater, std::move(query.entries), id_arena);
+}
+
+// Removes and adds the entries of the file changes, keeping the order of the walk:
+// the files first and the Microsoft Store apps after them.
+static void apply_file_changes(EntryUpdater& updater, Span<FileChange> changes) {
+	PROFILE_FUNCTION();
+
+	EntryUpdate update{};
+	prepare_entry_update(changes, update);
+
+	if (update.requires_rescan) {
+		log_info(L"some of the file changes were lost, rescanning the entries");
+		updater.is_rescan_requested = true;
+		return;
+	}
+
+	std::unordered_set<std::wstring> removed_paths;
+	for (const std::filesystem::path& path : update.removed_paths) {
+		removed_paths.emplace(path.wstring());
+	}
+
+	std::vector<Entry> file_entries;
+	file_entries.reserve(updater.entries.size() + update.added_entries.size());
+
+	for (const Entry& entry : updater.entries) {
+		if (!entry.is_microsoft_store_app && !is_entry_path_removed(entry.path, removed_paths)) {
+			file_entries.push_back(entry);
+		}
+	}
+
+	std::move(update.added_entries.begin(), update.added_entries.end(), std::back_inserter(file_entries));
+
+	// Sorted the same way as the files of the walk, otherwise the entries wouldn't be equal to the rescanned ones
+	std::vector<uint32_t> root_indices(file_entries.size());
+	std::vector<uint32_t> sorted_indices(file_entries.size());
+	for (uint32_t i = 0; i < (uint32_t)file_entries.size(); i++) {
+		root_indices[i] = find_walked_root_index(updater.roots, file_entries[i].path);
+		sorted_indices[i] = i;
+	}
+
+	std::sort(sorted_indices.begin(), sorted_indices.end(), [&](uint32_t a, uint32_t b) {
+		if (root_indices[a] != root_indices[b]) {
+			return root_indices[a] < root_indices[b];
+		}
+
+		return file_entries[a].path < file_entries[b].path;
+	});
+
+	ArenaSavePoint temp = arena_begin_temp(updater.temp_arena);
+
+	std::vector<Entry> updated_entries;
+	updated_entries.reserve(file_entries.size());
+
+	std::unordered_set<std::wstring_view> used_app_names;
+	for (uint32_t index : sorted_indices) {
+		std::wstring_view lower_name = wstr_to_lower(file_entries[index].name, updater.temp_arena);
+		if (used_app_names.contains(lower_name)) {
+			continue;
+		}
+
+		used_app_names.emplace(lower_name);
+		updated_entries.push_back(std::move(file_entries[index]));
+	}
+
+	for (const Entry& entry : updater.entries) {
+		if (entry.is_microsoft_store_app) {
+			updated_entries.push_back(entry);
+		}
+	}
+
+	arena_end_temp(temp);
+
+	if (!are_entries_equal(updater.entries, updated_entries)) {
+		post_updated_entries(updater, std::move(updated_entries), Arena{});
+	}
+}
+
+static void entry_updater_thread_worker(EntryUpdater* updater) {
+	log_init_thread(updater->arena, "entry_updater");
+	PROFILE_NAME_THREAD("entry_updater");
+
+	platform_initialize_thread();
+
+	std::vector<FileChange> changes;
+	while (true) {
+		// NOTE: The changes that happen during the rescan are applied on top of the rescanned entries afterwards
+		if (updater->is_rescan_requested) {
+			updater->is_rescan_requested = false;
+			rescan_entries(*updater);
+			continue;
+		}
+
+		if (updater->directory_watcher == nullptr) {
+			break;
+		}
+
+		size_t change_count = changes.size();
+		uint32_t timeout_ms = changes.empty() ? WAIT_WITHOUT_TIMEOUT : ENTRY_UPDATER_BATCH_DELAY_MS;
+
+		if (!fs_wait_for_file_changes(updater->directory_watcher, timeout_ms, changes)) {
+			break;
+		}
+
+		if (changes.empty() || changes.size() != change_count) {
+			continue;
+		}
 
-	arena_end_temp(temp_region);
-	entry.icon_is_loaded = true;
+		apply_file_changes(*updater, Span<FileChange>(changes.data(), changes.size()));
+		changes.clear();
+	}
+
+	platform_shutdown_thread();
+	log_shutdown_thread();
 }
 
-void enable_app() {
+// Watches the entry directories and rescans the entries first if `rescan` is set, which is the case when they were loaded
+// from the entry index. Wakes up the window when the entries have to be replaced, so must be started after the window was created.
+void start_entry_updater(EntryUpdater& updater, bool rescan) {
 	PROFILE_FUNCTION();
 
-	log_info(L"recieved activation notification from the keyboard hook");
+	updater.roots = get_entry_directory_paths();
+	updater.directory_watcher = fs_watch_directories(s_app.arena, updater.roots);
+	if (updater.directory_watcher == nullptr) {
+		log_warn(L"the entries won't be updated until restart");
+	}
 
-	if (s_app.config.disable_in_fullscreen && platform_has_running_fullscreen_app()) {
-		log_info(L"ignoring activation notification: a fullscreen application is running");
+	updater.is_rescan_requested = rescan;
+	if (updater.directory_watcher == nullptr && !rescan) {
 		return;
 	}
 
-	s_app.enable_var.notify_all();
-	s_app.is_active.store(true, std::memory_order::acquire);
+	updater.entries = s_app.entries;
+	updater.arena.capacity = mb_to_bytes(1);
+	updater.temp_arena.capacity = mb_to_bytes(8);
+	updater.thread = std::thread(entry_updater_thread_worker, &updater);
 }
 
-// Waits for the hook to notify about the activation
-void wait_for_activation() {
-	if (!s_app.use_keyboard_hook) {
-		s_app.state = AppState::Running;
-		return;
+// Waits for the rescan to complete, if there is one in progress
+void shutdown_entry_updater(EntryUpdater& updater) {
+	PROFILE_FUNCTION();
+
+	if (updater.directory_watcher != nullptr) {
+		fs_stop_watching_directories(updater.directory_watcher);
 	}
 
-	// Can happen that the hook notifies before this function is called
-	bool is_already_active = s_app.is_active.load(std::memory_order::relaxed);
-	if (is_already_active) {
-		log_info(L"already activated");
-	} else {
-		log_info(L"waiting for activation");
-		std::unique_lock lock(s_app.enable_mutex);
-		s_app.enable_var.wait(lock);
+	if (updater.thread.joinable()) {
+		updater.thread.join();
 	}
 
-	// The app was activated
-	s_app.state = AppState::Running;
-}
+	if (updater.directory_watcher != nullptr) {
+		fs_release_directory_watcher(updater.directory_watcher);
+	}
 
-void enter_sleep_mode() {
-	if (!s_app.use_keyboard_hook) {
-		window_close(*s_app.window);
-		return;
+	if (updater.has_unapplied_entries) {
+		search_corpus_release(updater.prepared_entries.corpus);
+		arena_release(updater.prepared_entries.id_arena);
+		updater.prepared_entries = {};
+		updater.has_unapplied_entries = false;
 	}
 
-	log_info(L"entering sleep mode");
-	s_app.is_active.store(false, std::memory_order::acquire);
-	wait_for_activation();
+	arena_release(updater.arena);
+	arena_release(updater.temp_arena);
 }
 
-//
-// Keyboard Hook
-//
+void shortcut_prefetcher_clear_requests(ShortcutPrefetcher& prefetcher);
 
-bool init_keyboard_hook(Arena& allocator) {
+// Replaces the `s_app.entries` and the search corpus with the prepared ones and restarts the search over them.
+//
+// The launch histories and the loaded icons are not scanned, so they are moved over to the new entries with the same name.
+static void replace_entries(std::vector<Entry> new_entries, const SearchCorpus& new_corpus) {
 	PROFILE_FUNCTION();
-	HookConfig config{};
-	config.app_enable_fn = enable_app;
-	s_app.keyboard_hook = keyboard_hook_init(allocator, config);
 
-	return s_app.keyboard_hook != nullptr;
-}
+	std::vector<uint32_t> new_entry_indices(s_app.entries.size(), UINT32_MAX);
+	{
+		std::unordered_map<std::wstring_view, uint32_t> new_entry_indices_by_name;
+		for (uint32_t i = 0; i < (uint32_t)new_entries.size(); i++) {
+			new_entry_indices_by_name.emplace(new_entries[i].name, i);
+		}
 
-void shutdown_keyboard_hook() {
-	keyboard_hook_shutdown(s_app.keyboard_hook);
-}
+		for (uint32_t i = 0; i < (uint32_t)s_app.entries.size(); i++) {
+			const Entry& entry = s_app.entries[i];
 
-//
-// Search Entries
-//
+			auto it = new_entry_indices_by_name.find(entry.name);
+			if (it == new_entry_indices_by_name.end()) {
+				continue;
+			}
 
-void resolve_shortcuts_task(const JobContext& context, void* data) {
-	PROFILE_FUNCTION();
+			new_entry_indices[i] = it->second;
 
-	Span<Entry> entries = Span(reinterpret_cast<Entry*>(data), context.batch_size);
-	for (Entry& entry : entries) {
-		if (entry.path.extension() == ".lnk") {
-			entry.resolved_path = fs_resolve_shortcut(entry.path);
-		} else {
-			entry.resolved_path = entry.path;
+			Entry& new_entry = new_entries[it->second];
+			new_entry.launch_history = entry.launch_history;
+			new_entry.frecency = entry.frecency;
+
+			// The shortcut might have been resolved lazily while the entries were updated
+			if (new_entry.resolved_path.empty() && entry.path == new_entry.path) {
+				new_entry.resolved_path = entry.resolved_path;
+			}
+
+			if (entry.icon_is_loaded && entry.resolved_path == new_entry.resolved_path && entry.logo_uri == new_entry.logo_uri) {
+				new_entry.icon_is_loaded = true;
+				new_entry.icon = entry.icon;
+			}
 		}
 	}
-}
 
-void walk_directory(const std::filesystem::path& path,
-		std::vector<Entry>& entries,
-		std::unordered_set<std::wstring_view>& used_app_names,
-		Arena& app_name_allocator) {
-	PROFILE_FUNCTION();
-	for (std::filesystem::path child : std::filesystem::directory_iterator(path)) {
-		if (std::filesystem::is_directory(child)) {
-			walk_directory(child, entries, used_app_names, app_name_allocator);
-		} else {
-			std::wstring application_name = child.filename().replace_extension("").wstring();
-			std::wstring_view lower_application_name = wstr_to_lower(application_name, app_name_allocator);
+	// The search refers to the entries and the corpus
+	async_search_stop(s_app.search);
+	search_corpus_release(s_app.search_corpus);
+	s_app.search_corpus = new_corpus;
 
-			if (used_app_names.contains(lower_application_name)) {
-				continue;
-			}
+	query_history_remap_entries(s_app.query_history, Span<const uint32_t>(new_entry_indices.data(), new_entry_indices.size()));
+	s_app.entries = std::move(new_entries);
 
-			Entry& entry = entries.emplace_back();
-			entry.name = std::move(application_name);
-			entry.path = child;
+	shortcut_prefetcher_clear_requests(s_app.shortcut_prefetcher);
 
-			used_app_names.emplace(lower_application_name);
-		}
+	start_search();
+
+	// The displayed results refer to the replaced entries, so the current query is repeated
+	s_app.result_view_state.result = {};
+	s_app.result_view_state.selected_index = 0;
+	s_app.result_view_state.scroll_offset = 0;
+
+	async_search_post_query(s_app.search,
+			text_input_state_get_text(s_app.search_input_state),
+			text_input_state_get_text(s_app.lang_agnostic_search_input_state));
+
+	{
+		ArenaSavePoint temp = arena_begin_temp(s_app.temp_arena);
+		StringBuilder<wchar_t> builder = { &s_app.temp_arena };
+		str_builder_append<wchar_t>(builder, L"the entries have changed, now there are ");
+		str_builder_append<wchar_t>(builder, std::to_wstring(s_app.entries.size()));
+		str_builder_append<wchar_t>(builder, L" entries");
+
+		log_info(str_builder_to_str(builder));
+		arena_end_temp(temp);
 	}
 }
 
-void serialize_frequency_scores(Span<const Entry> entries) {
+// Called on the main thread, when the updater has prepared the entries
+void apply_prepared_entries(EntryUpdater& updater) {
 	PROFILE_FUNCTION();
-	std::wofstream file(s_app.app_data_dir_path / SEARCH_SCORES_FILE_PATH);
-	for (const auto& entry : entries) {
-		if (entry.frequency_score > 0) {
-			file << entry.frequency_score << " \"" << entry.name << "\"\n";
+
+	PreparedEntries prepared{};
+	{
+		std::lock_guard lock(updater.prepared_entries_mutex);
+		if (!updater.has_unapplied_entries) {
+			return;
 		}
+
+		prepared = std::move(updater.prepared_entries);
+		updater.prepared_entries = {};
+		updater.has_unapplied_entries = false;
 	}
-}
 
-bool deserialize_frequency_scores(Span<Entry> entries, Arena& arena) {
-	PROFILE_FUNCTION();
+	replace_entries(std::move(prepared.entries), prepared.corpus);
 
-	std::wifstream stream(s_app.app_data_dir_path / SEARCH_SCORES_FILE_PATH);
-	if (!stream.is_open()) {
-		return false;
+	// The replaced entries were the last ones that referred to the ids in the previous arena
+	if (prepared.id_arena.capacity != 0) {
+		arena_release(s_app.entries_id_arena);
+		s_app.entries_id_arena = prepared.id_arena;
 	}
+}
 
-	stream.seekg(0, std::ios::end);
-	size_t size = stream.tellg();
-	stream.seekg(0, std::ios::beg);
-
-	ArenaSavePoint temp = arena_begin_temp(arena);
-	wchar_t* buffer = arena_alloc_array<wchar_t>(arena, size + 1);
-	buffer[size] = 0;
+//
+// Shortcut Prefetcher
+//
 
-	stream.read(buffer, size);
+// The number of the top results which have their shortcuts resolved before they are displayed
+static constexpr uint32_t SHORTCUT_PREFETCH_RESULT_COUNT = 32;
 
-	std::wstring_view file_content = std::wstring_view(buffer, size);
-	std::unordered_map<std::wstring_view, uint16_t> app_name_to_score;
+static bool is_entry_shortcut_unresolved(const Entry& entry) {
+	return !entry.is_microsoft_store_app && entry.resolved_path.empty();
+}
 
-	size_t read_position = 0;
-	while (read_position < file_content.size()) {
-		uint16_t score_value = 0;
-		while (read_position < file_content.size()
-				&& file_content[read_position] >= L'0'
-				&& file_content[read_position] <= L'9') {
+static void shortcut_prefetcher_thread_worker(ShortcutPrefetcher* prefetcher) {
+	log_init_thread(prefetcher->arena, "shortcut_prefetcher");
+	PROFILE_NAME_THREAD("shortcut_prefetcher");
 
-			uint16_t digit = file_content[read_position] - L'0';
-			score_value *= 10;
-			score_value += digit;
+	platform_initialize_thread();
 
-			read_position += 1;
-		}
+	while (true) {
+		ShortcutResolveRequest request{};
+		{
+			std::unique_lock lock(prefetcher->mutex);
+			prefetcher->request_var.wait(lock, [prefetcher]() {
+				return prefetcher->should_stop || !prefetcher->requests.empty();
+			});
 
-		// Parse the rest of the line
-		size_t after_score_position = read_position;
-		while (read_position < file_content.size() && file_content[read_position] != '\n') {
-			read_position += 1;
-		}
+			if (prefetcher->should_stop) {
+				break;
+			}
 
-		size_t name_start = after_score_position + 2;
-		size_t name_end = read_position - 1;
-		if (name_start >= file_content.size()
-				|| name_start >= name_end
-				|| file_content[after_score_position] != L' '
-				|| file_content[after_score_position + 1] != L'"'
-				|| file_content[read_position - 1] != L'"') {
-			read_position += 1; // skip new line char
-			continue;
+			request = std::move(prefetcher->requests.front());
+			prefetcher->requests.pop_front();
 		}
 
-		std::wstring_view application_name = file_content.substr(name_start,
-				name_end - name_start);
-
-		app_name_to_score.emplace(application_name, score_value);
+		std::filesystem::path resolved_path = fs_resolve_shortcut(request.path);
 
-		read_position += 1; // skip new line char
-	}
+		// The shortcut itself is used for the icon, so that a broken shortcut isn't requested again
+		if (resolved_path.empty()) {
+			resolved_path = request.path;
+		}
 
-	for (auto& entry : entries) {
-		auto it = app_name_to_score.find(entry.name);
-		if (it == app_name_to_score.end()) {
-			continue;
+		{
+			std::lock_guard lock(prefetcher->mutex);
+			prefetcher->resolved_shortcuts.push_back(ResolvedShortcut {
+				.entry_index = request.entry_index,
+				.path = std::move(request.path),
+				.resolved_path = std::move(resolved_path),
+			});
 		}
 
-		entry.frequency_score = it->second;
+		prefetcher->has_resolved_shortcuts.store(true, std::memory_order::release);
+		window_wake_up(s_app.window);
 	}
 
-	arena_end_temp(temp);
-
-	return true;
+	platform_shutdown_thread();
+	log_shutdown_thread();
 }
 
-struct SearchEntriesQuery {
-	InstalledAppsQueryState* installed_apps_query;
-};
+void start_shortcut_prefetcher(ShortcutPrefetcher& prefetcher) {
+	PROFILE_FUNCTION();
 
-void schedule_search_entries_query(SearchEntriesQuery& query_state) {
+	prefetcher.arena.capacity = mb_to_bytes(1);
+	prefetcher.thread = std::thread(shortcut_prefetcher_thread_worker, &prefetcher);
+}
+
+void shutdown_shortcut_prefetcher(ShortcutPrefetcher& prefetcher) {
 	PROFILE_FUNCTION();
 
-	std::vector<std::filesystem::path> known_folders = fs_get_known_folder_paths(
-			KnownFolderKind::Desktop | KnownFolderKind::StartMenu | KnownFolderKind::Programs);
+	if (!prefetcher.thread.joinable()) {
+		return;
+	}
 
 	{
-		ArenaSavePoint temp = arena_begin_temp(s_app.temp_arena);
+		std::lock_guard lock(prefetcher.mutex);
+		prefetcher.should_stop = true;
+	}
 
-		std::unordered_set<std::wstring_view> used_app_names;
-		for (const auto& known_folder : known_folders) {
-			try {
-				walk_directory(known_folder, s_app.entries, used_app_names, s_app.temp_arena);
-			} catch (std::exception e) {
-				log_error(e.what());
-			}
-		}
+	prefetcher.request_var.notify_one();
+	prefetcher.thread.join();
 
-		arena_end_temp(temp);
+	arena_release(prefetcher.arena);
+}
+
+// Requests the shortcut of the displayed entry in front of the prefetched ones.
+// Returns `false` if the shortcut is already resolved.
+static bool request_displayed_shortcut(ShortcutPrefetcher& prefetcher, uint32_t entry_index) {
+	const Entry& entry = s_app.entries[entry_index];
+	if (!is_entry_shortcut_unresolved(entry)) {
+		return false;
 	}
 
-	job_system_submit(resolve_shortcuts_task, s_app.entries.data(), s_app.entries.size());
+	if (prefetcher.requested_entries.contains(entry_index)) {
+		return true;
+	}
 
-	query_state.installed_apps_query = platform_begin_installed_apps_query(s_app.temp_arena,
-			s_app.config.ms_store_query_method == MSStoreQueryMethod::Experimental);
+	{
+		std::lock_guard lock(prefetcher.mutex);
+		prefetcher.requests.push_front(ShortcutResolveRequest { .entry_index = entry_index, .path = entry.path });
+	}
+
+	prefetcher.requested_entries.insert(entry_index);
+	prefetcher.request_var.notify_one();
+	return true;
 }
 
-void collect_search_entries_query_result(Arena& arena, Arena& temp_arena, SearchEntriesQuery& query_state) {
+// Replaces the pending requests with the top results of the new search result
+void prefetch_result_shortcuts(ShortcutPrefetcher& prefetcher, SearchResult& result) {
 	PROFILE_FUNCTION();
 
-	job_system_wait_for_all(arena, temp_arena);
-	
-	std::vector<InstalledAppDesc> installed_apps = platform_finish_installed_apps_query(
-			query_state.installed_apps_query,
-			arena,
-			temp_arena);
+	uint32_t prefetch_count = std::min(SHORTCUT_PREFETCH_RESULT_COUNT, (uint32_t)result.matches.size());
+	search_sort_results(result, prefetch_count);
 
-	// TODO: reserve entries
-	for (const auto& app_desc : installed_apps) {
-		Entry& entry = s_app.entries.emplace_back();
-		entry.name = app_desc.display_name;
-		entry.is_microsoft_store_app = true;
-		entry.icon = INVALID_ICON_POSITION;
-		entry.id = app_desc.id;
+	{
+		std::lock_guard lock(prefetcher.mutex);
+
+		// The shortcut that is being resolved stays in the `requested_entries` until it is applied
+		for (const ShortcutResolveRequest& request : prefetcher.requests) {
+			prefetcher.requested_entries.erase(request.entry_index);
+		}
 
-		TexturePixelData data = texture_load_pixel_data(app_desc.logo_uri);
-		if (data.pixels) {
-			ArenaSavePoint temp = arena_begin_temp(arena);
-			TexturePixelData downsampled = texture_downscale(data, 32, s_app.arena);
+		prefetcher.requests.clear();
 
-			entry.icon_is_loaded = true;
-			entry.icon = store_app_icon(s_app.app_icon_storage, downsampled.pixels);
+		for (uint32_t i = 0; i < prefetch_count; i++) {
+			uint32_t entry_index = result.matches[i].entry_index;
+			const Entry& entry = s_app.entries[entry_index];
 
-			texture_release_pixel_data(data);
-			arena_end_temp(temp);
+			if (is_entry_shortcut_unresolved(entry) && !prefetcher.requested_entries.contains(entry_index)) {
+				prefetcher.requests.push_back(ShortcutResolveRequest { .entry_index = entry_index, .path = entry.path });
+				prefetcher.requested_entries.insert(entry_index);
+			}
 		}
 	}
 
-	{
-		ArenaSavePoint temp = arena_begin_temp(arena);
-		StringBuilder<wchar_t> builder = { &arena };
-		str_builder_append<wchar_t>(builder, L"loaded ");
-		str_builder_append<wchar_t>(builder, std::to_wstring(s_app.entries.size()));
-		str_builder_append<wchar_t>(builder, L" entries");
-
-		log_info(str_builder_to_str(builder));
-		arena_end_temp(temp);
-	}
+	prefetcher.request_var.notify_one();
+}
 
+// Called after the entries were replaced, because the requests refer to them by the index
+void shortcut_prefetcher_clear_requests(ShortcutPrefetcher& prefetcher) {
+	std::lock_guard lock(prefetcher.mutex);
+	prefetcher.requests.clear();
+	prefetcher.requested_entries.clear();
 }
 
-void clear_search_result() {
+// Called on the main thread, when the prefetcher has resolved some of the shortcuts
+void apply_resolved_shortcuts(ShortcutPrefetcher& prefetcher) {
 	PROFILE_FUNCTION();
 
-	ui::text_input_state_clear(s_app.search_input_state);
-	ui::text_input_state_clear(s_app.lang_agnostic_search_input_state);
-	update_search_result({}, {},
-			s_app.entries,
-			s_app.result_view_state.matches,
-			s_app.result_view_state.highlights,
-			s_app.arena);
+	std::vector<ResolvedShortcut> resolved_shortcuts;
+	{
+		std::lock_guard lock(prefetcher.mutex);
+		std::swap(resolved_shortcuts, prefetcher.resolved_shortcuts);
+	}
+
+	for (ResolvedShortcut& shortcut : resolved_shortcuts) {
+		prefetcher.requested_entries.erase(shortcut.entry_index);
+
+		if (shortcut.entry_index >= s_app.entries.size()) {
+			continue;
+		}
+
+		Entry& entry = s_app.entries[shortcut.entry_index];
+		if (!is_entry_shortcut_unresolved(entry) || entry.path != shortcut.path) {
+			continue;
+		}
+
+		// NOTE: The search corpus is not rebuilt, so the resolved name is only searchable after the restart
+		entry.resolved_path = std::move(shortcut.resolved_path);
+		prefetcher.has_unsaved_shortcuts = true;
+	}
 }
 
 //
@@ -869,6 +2082,17 @@ struct ConfigLoaderState {
 	const AppConfig& default_config;
 };
 
+// The weight must be between 0 and 1, zero disables the field
+static bool parse_search_field_weight(const char* value_str, SearchField field, SearchFieldWeights& out_weights) {
+	float weight = (float)atof(value_str);
+	if (weight < 0.0f || weight > 1.0f) {
+		return false;
+	}
+
+	out_weights.values[(uint32_t)field] = weight;
+	return true;
+}
+
 static int ini_config_handler(void* user_data, const char* section_str, const char* name_str, const char* value_str) {
 	ConfigLoaderState& state = *(ConfigLoaderState*)user_data;
 
@@ -915,6 +2139,45 @@ static int ini_config_handler(void* user_data, const char* section_str, const ch
 				log_error(L"invalid value for property `ms_store_apps_query_method`");
 				return 0;
 			}
+		} else if (name == "parallel_search_threshold") {
+			int32_t threshold = atoi(value_str);
+			if (threshold >= 0) {
+				state.out_config.parallel_search_threshold = threshold;
+			} else {
+				log_error(L"invalid value for property `parallel_search_threshold`");
+				return 0;
+			}
+		} else if (name == "frecency_weight") {
+			float weight = (float)atof(value_str);
+			if (weight >= 0.0f) {
+				state.out_config.frecency_weight = weight;
+			} else {
+				log_error(L"invalid value for property `frecency_weight`");
+				return 0;
+			}
+		} else if (name == "file_name_weight") {
+			if (!parse_search_field_weight(value_str, SearchField::FileName, state.out_config.search_field_weights)) {
+				log_error(L"invalid value for property `file_name_weight`");
+				return 0;
+			}
+		} else if (name == "parent_folder_weight") {
+			if (!parse_search_field_weight(value_str, SearchField::ParentFolder, state.out_config.search_field_weights)) {
+				log_error(L"invalid value for property `parent_folder_weight`");
+				return 0;
+			}
+		} else if (name == "package_id_weight") {
+			if (!parse_search_field_weight(value_str, SearchField::PackageId, state.out_config.search_field_weights)) {
+				log_error(L"invalid value for property `package_id_weight`");
+				return 0;
+			}
+		} else if (name == "search_index_threshold") {
+			int32_t threshold = atoi(value_str);
+			if (threshold >= 0) {
+				state.out_config.search_index_threshold = threshold;
+			} else {
+				log_error(L"invalid value for property `search_index_threshold`");
+				return 0;
+			}
 		}
 	} else if (section == "system") {
 		if (name == "disable_in_fullscreen") {
@@ -927,6 +2190,24 @@ static int ini_config_handler(void* user_data, const char* section_str, const ch
 				log_error(L"expected a boolean value for property `disable_in_fullscreen`");
 				return 0;
 			}
+		} else if (name == "lazy_shortcut_resolution") {
+			std::string value = value_str;
+			if (value == "true") {
+				state.out_config.lazy_shortcut_resolution = true;
+			} else if (value == "false") {
+				state.out_config.lazy_shortcut_resolution = false;
+			} else {
+				log_error(L"expected a boolean value for property `lazy_shortcut_resolution`");
+				return 0;
+			}
+		} else if (name == "shortcut_resolve_batch_size") {
+			int32_t batch_size = atoi(value_str);
+			if (batch_size > 0) {
+				state.out_config.shortcut_resolve_batch_size = batch_size;
+			} else {
+				log_error(L"invalid value for property `shortcut_resolve_batch_size`");
+				return 0;
+			}
 		}
 	} else {
 		log_error(L"unknown config section name");
@@ -1079,6 +2360,14 @@ void run_app_frame() {
 	const ui::Theme& theme = ui::get_theme();
 	ui::Options& options = ui::get_options();
 
+	if (async_search_take_result(s_app.search, s_app.result_view_state.result)) {
+		s_app.result_view_state.selected_index = 0;
+
+		if (s_app.config.lazy_shortcut_resolution) {
+			prefetch_result_shortcuts(s_app.shortcut_prefetcher, s_app.result_view_state.result);
+		}
+	}
+
 	Span<const WindowEvent> events = window_get_events(s_app.window);
 	for (size_t i = 0; i < events.count; i++) {
 		switch (events[i].kind) {
@@ -1112,7 +2401,11 @@ void run_app_frame() {
 		}
 		case WindowEventKind::MouseScroll: {
 			int32_t scroll_rows = -events[i].data.mouse_scroll.delta / 120;
-			size_t result_count = s_app.result_view_state.matches.size();
+			size_t result_count = s_app.result_view_state.result.matches.size();
+			if (result_count == 0) {
+				break;
+			}
+
 			size_t selected_index = s_app.result_view_state.selected_index;
 			s_app.result_view_state.selected_index = (selected_index + result_count + scroll_rows) % result_count;
 			break;
@@ -1144,14 +2437,7 @@ void run_app_frame() {
 			std::wstring_view search_pattern = text_input_state_get_text(s_app.search_input_state);
 			std::wstring_view lang_agnostic_search_pattern = text_input_state_get_text(s_app.lang_agnostic_search_input_state);
 
-			update_search_result(search_pattern,
-					lang_agnostic_search_pattern,
-					s_app.entries,
-					s_app.result_view_state.matches,
-					s_app.result_view_state.highlights,
-					s_app.arena);
-
-			s_app.result_view_state.selected_index = 0;
+			async_search_post_query(s_app.search, search_pattern, lang_agnostic_search_pattern);
 		}
 
 		ui::WidgetStyle close_icon_style = theme.default_button_style;
@@ -1184,19 +2470,28 @@ void run_app_frame() {
 
 	update_result_view_scroll(s_app.result_view_state);
 
+	search_sort_results(s_app.result_view_state.result,
+			s_app.result_view_state.scroll_offset + partially_visible_item_count);
+
 	uint32_t visible_item_count = std::min(
 			partially_visible_item_count,
-			(uint32_t)s_app.result_view_state.matches.size() - s_app.result_view_state.scroll_offset);
+			(uint32_t)s_app.result_view_state.result.matches.size() - s_app.result_view_state.scroll_offset);
 
 	auto& result_view_state = s_app.result_view_state;
 
 	for (uint32_t i = result_view_state.scroll_offset; i < result_view_state.scroll_offset + visible_item_count; i++) {
 		bool is_selected = i == result_view_state.selected_index;
 
-		const ResultEntry& match = s_app.result_view_state.matches[i];
+		search_result_compute_highlights(result_view_state.result, i, s_app.search_corpus, s_app.temp_arena);
+
+		const ResultEntry& match = s_app.result_view_state.result.matches[i];
 		Entry& entry = s_app.entries[match.entry_index];
 
-		if (!entry.icon_is_loaded) {
+		// The icon is loaded from the target of the shortcut, so it waits until the shortcut is resolved
+		bool is_shortcut_pending = s_app.config.lazy_shortcut_resolution
+			&& request_displayed_shortcut(s_app.shortcut_prefetcher, match.entry_index);
+
+		if (!entry.icon_is_loaded && !is_shortcut_pending) {
 			try_load_app_entry_icon(s_app.app_icon_storage, entry, s_app.arena);
 		}
 
@@ -1221,11 +2516,21 @@ void run_app_frame() {
 			params->as_admin = action == EntryAction::LaunchAsAdmin;
 			params->entry = entry;
 
-			if (entry.frequency_score != UINT16_MAX) {
-				entry.frequency_score += 1;
-			}
+			uint32_t current_week = launch_history_get_current_week();
+			launch_history_record_launch(entry.launch_history, current_week);
+			entry.frecency = launch_history_compute_frecency(entry.launch_history, current_week);
+			async_search_update_entry_frecency(s_app.search, match.entry_index, entry.frecency);
+
+			serialize_launch_histories(Span<const Entry>(s_app.entries.data(), s_app.entries.size()));
 
-			job_system_submit(launch_app_task, params);
+			query_history_record_launch(s_app.query_history,
+					result_view_state.result.pattern,
+					result_view_state.result.lang_agnostic_pattern,
+					match.entry_index);
+			async_search_update_query_history(s_app.search, s_app.query_history);
+			serialize_query_history(s_app.query_history, Span<const Entry>(s_app.entries.data(), s_app.entries.size()));
+
+			job_system_submit(nullptr, launch_app_task, params);
 
 			s_app.state = AppState::Sleeping;
 			clear_search_result();
@@ -1238,8 +2543,6 @@ void run_app_frame() {
 			}
 			break;
 		}
-
-		serialize_frequency_scores(Span<const Entry>(s_app.entries.data(), s_app.entries.size()));
 	}
 
 	ui::end_vertical_layout();
@@ -1302,6 +2605,13 @@ int run_app(CommandLineArgs cmd_args) {
 		default_app_config.window_height = 500;
 		
 		default_app_config.ms_store_query_method = MSStoreQueryMethod::Default;
+		default_app_config.parallel_search_threshold = DEFAULT_PARALLEL_SEARCH_THRESHOLD;
+		default_app_config.search_index_threshold = DEFAULT_SEARCH_INDEX_THRESHOLD;
+		default_app_config.frecency_weight = DEFAULT_FRECENCY_WEIGHT;
+		default_app_config.search_field_weights = DEFAULT_SEARCH_FIELD_WEIGHTS;
+
+		default_app_config.shortcut_resolve_batch_size = DEFAULT_SHORTCUT_RESOLVE_BATCH_SIZE;
+		default_app_config.lazy_shortcut_resolution = false;
 
 		app_config = default_app_config;
 
@@ -1329,8 +2639,13 @@ int run_app(CommandLineArgs cmd_args) {
 
 	platform_initialize();
 
+	// The entries of the previous run are searchable right away, then they are rescanned in the background
+	bool is_entry_index_loaded = deserialize_entry_index(s_app.entries, s_app.arena);
+
 	SearchEntriesQuery search_entries_query{};
-	schedule_search_entries_query(search_entries_query);
+	if (!is_entry_index_loaded) {
+		schedule_search_entries_query(search_entries_query, s_app.arena, s_app.temp_arena, nullptr);
+	}
 
 	if (s_app.use_keyboard_hook) {
 		init_keyboard_hook(s_app.arena);
@@ -1341,10 +2656,26 @@ int run_app(CommandLineArgs cmd_args) {
 	initialize_app();
 	window_hide(s_app.window);
 
-	// At this point the search entry must be made available
-	collect_search_entries_query_result(s_app.arena, s_app.temp_arena, search_entries_query);
+	if (!is_entry_index_loaded) {
+		// At this point the search entry must be made available
+		collect_search_entries_query_result(s_app.arena, s_app.temp_arena, search_entries_query);
+		s_app.entries = std::move(search_entries_query.entries);
+
+		serialize_entry_index(Span<const Entry>(s_app.entries.data(), s_app.entries.size()));
+	}
+
+	deserialize_launch_histories(Span(s_app.entries.data(), s_app.entries.size()), s_app.arena);
+	deserialize_query_history(s_app.query_history, Span<const Entry>(s_app.entries.data(), s_app.entries.size()), s_app.arena);
+	update_frecency_scores();
+
+	build_search_corpus(s_app.search_corpus, s_app.entries, s_app.arena, s_app.temp_arena);
+	start_search();
+
+	start_entry_updater(s_app.entry_updater, is_entry_index_loaded);
 
-	deserialize_frequency_scores(Span(s_app.entries.data(), s_app.entries.size()), s_app.arena);
+	if (app_config.lazy_shortcut_resolution) {
+		start_shortcut_prefetcher(s_app.shortcut_prefetcher);
+	}
 
 	clear_search_result();
 
@@ -1366,6 +2697,14 @@ int run_app(CommandLineArgs cmd_args) {
 				window_poll_events(s_app.window);
 			}
 
+			if (s_app.entry_updater.has_prepared_entries.exchange(false, std::memory_order::acquire)) {
+				apply_prepared_entries(s_app.entry_updater);
+			}
+
+			if (s_app.shortcut_prefetcher.has_resolved_shortcuts.exchange(false, std::memory_order::acquire)) {
+				apply_resolved_shortcuts(s_app.shortcut_prefetcher);
+			}
+
 			run_app_frame();
 
 			arena_reset(s_app.temp_arena);
@@ -1377,12 +2716,19 @@ int run_app(CommandLineArgs cmd_args) {
 			window_hide(s_app.window);
 			enter_sleep_mode();
 
+			// Rerun the empty query, because the order of the results depends on the frecency
+			if (update_frecency_scores()) {
+				async_search_update_frecencies(s_app.search, s_app.entries);
+				clear_search_result();
+			}
+
 			window_show(s_app.window);
 			break;
 		}
 	}
 
-	serialize_frequency_scores(Span<const Entry>(s_app.entries.data(), s_app.entries.size()));
+	serialize_launch_histories(Span<const Entry>(s_app.entries.data(), s_app.entries.size()));
+	serialize_query_history(s_app.query_history, Span<const Entry>(s_app.entries.data(), s_app.entries.size()));
 
 	log_info(L"terminated");
 
@@ -1390,6 +2736,20 @@ int run_app(CommandLineArgs cmd_args) {
 		shutdown_keyboard_hook();
 	}
 
+	// The updater, the prefetcher and the search wake up the window, so they are stopped before the window is destroyed.
+	// The rescan can't be abandoned, but it has to complete before the job system is shut down.
+	shutdown_entry_updater(s_app.entry_updater);
+	shutdown_shortcut_prefetcher(s_app.shortcut_prefetcher);
+
+	// The lazily resolved shortcuts are reused by the next run
+	if (s_app.shortcut_prefetcher.has_unsaved_shortcuts) {
+		serialize_entry_index(Span<const Entry>(s_app.entries.data(), s_app.entries.size()));
+	}
+
+	// The search thread also logs and can wait for its jobs until it is stopped
+	async_search_stop(s_app.search);
+	search_corpus_release(s_app.search_corpus);
+
 	delete_texture(s_app.app_icon_storage.texture);
 	delete_texture(s_app.icons.texture);
 	delete_font(s_app.font);
@@ -1403,6 +2763,8 @@ int run_app(CommandLineArgs cmd_args) {
 	log_shutdown_thread();
 	log_shutdown();
 
+	arena_release(s_app.entries_id_arena);
+
 	arena_release(s_app.arena);
 	arena_release(s_app.temp_arena);
 
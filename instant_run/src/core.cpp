@@ -1,9 +1,16 @@
 #include "core.h"
 
 #include <stdio.h>
-#include <windows.h>
 #include <fstream>
 
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <unistd.h>
+	#include <cwchar>
+#endif
+
 //
 // Assert
 //
@@ -32,10 +39,14 @@ void query_system_memory_spec() {
 		return;
 	}
 
+#ifdef _WIN32
 	SYSTEM_INFO sys_info = {};
 	GetSystemInfo(&sys_info);
 
 	s_sys_mem_spec.page_size = (size_t)sys_info.dwPageSize;
+#else
+	s_sys_mem_spec.page_size = (size_t)sysconf(_SC_PAGESIZE);
+#endif
 }
 
 // NOTE: Assumes the sys mem spec had already been queried
@@ -54,6 +65,7 @@ void arena_reserve(Arena& arena, size_t initial_size) {
 
 	size_t aligned_allocation = align(initial_size, s_sys_mem_spec.page_size);
 
+#ifdef _WIN32
 	arena.base = (uint8_t*)VirtualAlloc(NULL,
 			(SIZE_T)align(arena.capacity, s_sys_mem_spec.page_size),
 			MEM_RESERVE,
@@ -63,6 +75,21 @@ void arena_reserve(Arena& arena, size_t initial_size) {
 
 	void* alloc_result = VirtualAlloc(arena.base, (SIZE_T)aligned_allocation, MEM_COMMIT, PAGE_READWRITE);
 	assert(alloc_result != NULL);
+#else
+	// The reserved pages are inaccessible until they are commited by making them writable
+	void* reserve_result = mmap(NULL,
+			align(arena.capacity, s_sys_mem_spec.page_size),
+			PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+			-1,
+			0);
+
+	assert(reserve_result != MAP_FAILED);
+	arena.base = (uint8_t*)reserve_result;
+
+	[[maybe_unused]] int commit_result = mprotect(arena.base, aligned_allocation, PROT_READ | PROT_WRITE);
+	assert(commit_result == 0);
+#endif
 
 	arena.commited = aligned_allocation;
 }
@@ -73,12 +100,17 @@ void arena_commit_page(Arena& arena, size_t page_count) {
 	size_t commit_size = page_count * s_sys_mem_spec.page_size;
 	assert_msg(arena.commited + commit_size <= arena.capacity, "Out of arena memory");
 
+#ifdef _WIN32
 	void* result = VirtualAlloc(arena.base + arena.commited,
 			(SIZE_T)commit_size,
 			MEM_COMMIT,
 			PAGE_READWRITE);
 
 	assert(result != NULL);
+#else
+	[[maybe_unused]] int result = mprotect(arena.base + arena.commited, commit_size, PROT_READ | PROT_WRITE);
+	assert(result == 0);
+#endif
 
 	arena.commited += commit_size;
 }
@@ -90,7 +122,8 @@ void* arena_alloc_aligned(Arena& arena, size_t size, size_t alignment) {
 	if (arena.base == NULL) {
 		arena_reserve(arena, size);
 	} else if (new_allocated_ptr > arena.commited) {
-		arena_commit_page(arena, compute_page_count(new_allocated_ptr - arena.allocated));
+		// NOTE: The pages are committed after the already committed ones
+		arena_commit_page(arena, compute_page_count(new_allocated_ptr - arena.commited));
 	}
 
 	void* allocation = arena.base + allocation_base;
@@ -105,8 +138,13 @@ void arena_release(Arena& arena) {
 		return;
 	}
 
+#ifdef _WIN32
 	BOOL free_result = VirtualFree(arena.base, 0, MEM_RELEASE);
 	assert_msg(free_result, "Failed to release an arena");
+#else
+	[[maybe_unused]] int free_result = munmap(arena.base, align(arena.capacity, s_sys_mem_spec.page_size));
+	assert_msg(free_result == 0, "Failed to release an arena");
+#endif
 
 	arena.base = NULL;
 	arena.allocated = 0;
@@ -117,6 +155,32 @@ void arena_release(Arena& arena) {
 // String
 //
 
+// Converts the `string_length` chars of the `string` into the `buffer`, which must have space for `string_length + 1` chars.
+//
+// Same as the `mbstowcs_s`, the `out_chars_converted` includes the null-terminator.
+static bool convert_multibyte_to_wide(const char* string, size_t string_length, wchar_t* buffer, size_t* out_chars_converted) {
+#ifdef _WIN32
+	errno_t error = mbstowcs_s(out_chars_converted,
+			buffer,
+			string_length + 1,
+			string,
+			string_length);
+
+	return error == 0;
+#else
+	mbstate_t state{};
+	const char* source = string;
+	size_t chars_converted = mbsnrtowcs(buffer, &source, string_length, string_length, &state);
+	if (chars_converted == (size_t)-1) {
+		return false;
+	}
+
+	buffer[chars_converted] = L'\0';
+	*out_chars_converted = chars_converted + 1;
+	return true;
+#endif
+}
+
 wchar_t* cstring_to_wide(const char* string, Arena& arena) {
 	PROFILE_FUNCTION();
 
@@ -126,19 +190,15 @@ wchar_t* cstring_to_wide(const char* string, Arena& arena) {
 	wchar_t* buffer = arena_alloc_array<wchar_t>(arena, string_length + 1);
 
 	size_t chars_converted = 0;
-	errno_t error = mbstowcs_s(&chars_converted,
-			buffer,
-			string_length + 1,
-			string,
-			string_length);
+	bool is_converted = convert_multibyte_to_wide(string, string_length, buffer, &chars_converted);
 
-	if (error == 0) {
+	if (is_converted) {
 		return buffer;
 	}
 
 	// delete the allocated buffer, because the convertion failed
 	arena_end_temp(temp);
-	return nullptr;
+	return {};
 }
 
 std::wstring_view string_to_wide(std::string_view string, Arena& arena) {
@@ -152,13 +212,9 @@ std::wstring_view string_to_wide(std::string_view string, Arena& arena) {
 	wchar_t* buffer = arena_alloc_array<wchar_t>(arena, string_length + 1);
 
 	size_t chars_converted = 0;
-	errno_t error = mbstowcs_s(&chars_converted,
-			buffer,
-			string_length + 1,
-			string.data(),
-			string_length);
+	bool is_converted = convert_multibyte_to_wide(string.data(), string_length, buffer, &chars_converted);
 
-	if (error == 0) {
+	if (is_converted) {
 		// Get rid of the null-terminator, by moving
 		// the arena pointer back (deallocating it from the arena)
 		arena.allocated -= sizeof(*buffer);
@@ -167,7 +223,7 @@ std::wstring_view string_to_wide(std::string_view string, Arena& arena) {
 
 	// delete the allocated buffer, because the convertion failed
 	arena_end_temp(temp);
-	return nullptr;
+	return {};
 }
 
 //
@@ -186,7 +242,6 @@ bool read_text_file(const std::filesystem::path& path, Arena& arena, std::string
 	size_t size = stream.tellg();
 	stream.seekg(0, std::ios::beg);
 
-	ArenaSavePoint temp = arena_begin_temp(arena);
 	char* buffer = arena_alloc_array<char>(arena, size);
 
 	stream.read(buffer, size);
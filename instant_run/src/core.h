@@ -4,6 +4,7 @@
 #include <string_view>
 #include <filesystem>
 #include <cwctype>
+#include <cstring>
 
 #ifdef ENABLE_PROFILING 
 #include <tracy/Tracy.hpp>
@@ -53,7 +54,11 @@
 #define ENABLE_ASSERTIONS
 #endif
 
+#ifdef _WIN32
 #define DEBUG_BREAK() __debugbreak()
+#else
+#define DEBUG_BREAK() __builtin_trap()
+#endif
 
 #ifdef ENABLE_ASSERTIONS
 
@@ -271,8 +276,8 @@ std::wstring_view string_to_wide(std::string_view string, Arena& arena);
 template<typename T>
 struct StringBuilder {
 	Arena* arena;
-	const T* string;
-	size_t length;
+	const T* string = nullptr;
+	size_t length = 0;
 };
 
 template<typename T>
@@ -7,7 +7,6 @@
 #include <thread>
 #include <mutex>
 #include <vector>
-#include <queue>
 #include <string>
 #include <condition_variable>
 
@@ -15,58 +14,117 @@ struct Task {
 	JobSystemTask task_func;
 	void* user_data;
 	size_t batch_size;
+	JobGroup* group;
 };
 
+static constexpr size_t INITIAL_TASK_QUEUE_CAPACITY = 256;
+
+// Ring buffer of the submitted tasks, the storage only grows when the queue is full,
+// so submitting tasks doesn't allocate once the queue has grown to the peak number of tasks.
+struct TaskQueue {
+	std::vector<Task> tasks;
+	size_t read_index;
+	size_t count;
+};
+
+static void task_queue_push(TaskQueue& queue, const Task& task) {
+	if (queue.count == queue.tasks.size()) {
+		std::vector<Task> grown_tasks(max(queue.tasks.size() * 2, INITIAL_TASK_QUEUE_CAPACITY));
+		for (size_t i = 0; i < queue.count; i++) {
+			grown_tasks[i] = queue.tasks[(queue.read_index + i) % queue.tasks.size()];
+		}
+
+		queue.tasks = std::move(grown_tasks);
+		queue.read_index = 0;
+	}
+
+	queue.tasks[(queue.read_index + queue.count) % queue.tasks.size()] = task;
+	queue.count += 1;
+}
+
+static bool task_queue_pop(TaskQueue& queue, Task* out_task) {
+	if (queue.count == 0) {
+		return false;
+	}
+
+	*out_task = queue.tasks[queue.read_index];
+	queue.read_index = (queue.read_index + 1) % queue.tasks.size();
+	queue.count -= 1;
+
+	return true;
+}
+
+// Pops the oldest task of the `group`, the tasks after it are shifted to keep the order
+static bool task_queue_pop_group(TaskQueue& queue, const JobGroup* group, Task* out_task) {
+	size_t capacity = queue.tasks.size();
+
+	for (size_t i = 0; i < queue.count; i++) {
+		if (queue.tasks[(queue.read_index + i) % capacity].group != group) {
+			continue;
+		}
+
+		*out_task = queue.tasks[(queue.read_index + i) % capacity];
+
+		for (size_t j = i; j + 1 < queue.count; j++) {
+			queue.tasks[(queue.read_index + j) % capacity] = queue.tasks[(queue.read_index + j + 1) % capacity];
+		}
+
+		queue.count -= 1;
+		return true;
+	}
+
+	return false;
+}
+
 struct JobSystemState {
 	std::vector<std::thread> worker_threads;
 
 	std::atomic_bool is_running;
-	std::atomic_uint32_t active_worker_count;
 
 	std::mutex wake_mutex;
 	std::condition_variable wake_var;
 
 	// Task queue
 	std::mutex queue_mutex;
-	std::queue<Task> task_queue;
+	TaskQueue task_queue;
 };
 
 static JobSystemState s_job_sys_state;
 
-static bool try_pop_task(Task* out_task) {
+// Pops any task when the `group` is `nullptr`, otherwise only the tasks of the `group`
+static bool try_pop_task(const JobGroup* group, Task* out_task) {
 	PROFILE_FUNCTION();
 
 	std::unique_lock lock(s_job_sys_state.queue_mutex);
-	if (s_job_sys_state.task_queue.size() == 0) {
-		return false;
+	if (group == nullptr) {
+		return task_queue_pop(s_job_sys_state.task_queue, out_task);
 	}
 
-	*out_task = s_job_sys_state.task_queue.front();
-	s_job_sys_state.task_queue.pop();
-
-	return true;
+	return task_queue_pop_group(s_job_sys_state.task_queue, group, out_task);
 }
 
-static bool try_execute_single_task(JobContext& context) {
+static bool try_execute_single_task(JobContext& context, const JobGroup* group) {
 	PROFILE_FUNCTION();
 
 	ArenaSavePoint temp = arena_begin_temp(context.temp_arena);
 
 	Task task{};
-	bool has_task = try_pop_task(&task);
+	bool has_task = try_pop_task(group, &task);
 
 	if (!has_task) {
 		return false;
 	}
 
-	s_job_sys_state.active_worker_count.fetch_add(1, std::memory_order::acquire);
-
 	{
 		context.batch_size = task.batch_size;
+		context.group = task.group;
 		task.task_func(context, task.user_data);
 	}
 
-	s_job_sys_state.active_worker_count.fetch_sub(1, std::memory_order::acquire);
+	// The jobs submitted by the task were counted before it completes, so the group can't be observed as completed early
+	if (task.group != nullptr) {
+		task.group->pending_job_count.fetch_sub(1, std::memory_order::release);
+	}
 
 	arena_end_temp(temp);
 
@@ -99,8 +157,8 @@ static void thread_worker(uint32_t index) {
 			break;
 		}
 
-		JobContext context = { .arena = generic_arena, .temp_arena = temp_arena, .worker_index = index };
-		bool has_task = try_execute_single_task(context);
+		JobContext context = { .arena = generic_arena, .temp_arena = temp_arena, .batch_size = 0, .worker_index = index, .group = nullptr };
+		bool has_task = try_execute_single_task(context, nullptr);
 
 		if (!has_task) {
 			log_info(L"task queue is empty");
@@ -123,7 +181,8 @@ static void thread_worker(uint32_t index) {
 void job_system_init(uint32_t worker_count) {
 	PROFILE_FUNCTION();
 	
-	s_job_sys_state.is_running.store(true, std::memory_order::acquire);
+	s_job_sys_state.is_running.store(true, std::memory_order::release);
+	s_job_sys_state.task_queue.tasks.resize(INITIAL_TASK_QUEUE_CAPACITY);
 
 	for (uint32_t i = 0; i < worker_count; i++) {
 		s_job_sys_state.worker_threads.push_back(std::thread(thread_worker, i));
@@ -136,37 +195,41 @@ uint32_t job_system_get_worker_count() {
 	return (uint32_t)s_job_sys_state.worker_threads.size();
 }
 
-void job_system_submit(JobSystemTask task, void* user_data, size_t batch_size) {
+void job_system_submit(JobGroup* group, JobSystemTask task, void* user_data, size_t batch_size) {
 	PROFILE_FUNCTION();
 
+	if (group != nullptr) {
+		group->pending_job_count.fetch_add(1, std::memory_order::relaxed);
+	}
+
 	{
 		PROFILE_SCOPE("append_task");
 		std::unique_lock lock(s_job_sys_state.queue_mutex);
-		s_job_sys_state.task_queue.push(Task { .task_func = task, .user_data = user_data, .batch_size = batch_size });
+		task_queue_push(s_job_sys_state.task_queue, Task {
+			.task_func = task,
+			.user_data = user_data,
+			.batch_size = batch_size,
+			.group = group,
+		});
 	}
 
 	s_job_sys_state.wake_var.notify_one();
 }
 
-void job_system_wait_for_all(Arena& arena, Arena& temp_arena) {
+void job_system_wait_for_group(JobGroup& group, Arena& arena, Arena& temp_arena) {
 	PROFILE_FUNCTION();
 
-	JobContext context = { .arena = arena, .temp_arena = temp_arena, .worker_index = job_system_get_worker_count() };
-	while (true) {
-		if (!try_execute_single_task(context)) {
-			break;
-		}
-	}
-
-	{
-		PROFILE_SCOPE("wait_idle");
-		while (true) {
-			uint32_t active_worker_count = s_job_sys_state.active_worker_count.load(std::memory_order::relaxed);
-			if (active_worker_count == 0) {
-				break;
-			} else {
-				std::this_thread::yield();
-			}
+	JobContext context = {
+		.arena = arena,
+		.temp_arena = temp_arena,
+		.batch_size = 0,
+		.worker_index = job_system_get_worker_count(),
+		.group = nullptr,
+	};
+	while (group.pending_job_count.load(std::memory_order::acquire) != 0) {
+		// The rest of the jobs of the group are running on the workers
+		if (!try_execute_single_task(context, &group)) {
+			std::this_thread::yield();
 		}
 	}
 }
@@ -174,7 +237,7 @@ void job_system_wait_for_all(Arena& arena, Arena& temp_arena) {
 void job_system_shutdown() {
 	PROFILE_FUNCTION();
 
-	s_job_sys_state.is_running.store(false, std::memory_order::acquire);
+	s_job_sys_state.is_running.store(false, std::memory_order::release);
 	s_job_sys_state.wake_var.notify_all();
 	
 	for (auto& worker : s_job_sys_state.worker_threads) {
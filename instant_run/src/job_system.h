@@ -1,27 +1,40 @@
 #pragma once
 
 #include "core.h"
+#include "math.h"
 
 #include <stdint.h>
+#include <atomic>
 
 struct Arena;
+struct JobGroup;
 
 struct JobContext {
 	Arena& arena;
 	Arena& temp_arena;
 	size_t batch_size;
 	uint32_t worker_index;
+
+	// The group of the running job, the jobs that it submits into it are waited for together with it
+	JobGroup* group;
 };
 
 using JobSystemTask = void(*)(const JobContext& context, void* user_data);
 
+// Counts the pending jobs of a single submitter, so that waiting for them
+// neither waits for nor executes the jobs submitted by the other threads
+struct JobGroup {
+	std::atomic_uint32_t pending_job_count;
+};
+
 void job_system_init(uint32_t worker_count);
 uint32_t job_system_get_worker_count();
 
-void job_system_submit(JobSystemTask task, void* user_data, size_t batch_size = 1);
+// The `group` can be `nullptr` for the jobs that are never waited for, then only the workers execute them
+void job_system_submit(JobGroup* group, JobSystemTask task, void* user_data, size_t batch_size = 1);
 
 template<typename T>
-void job_system_submit_batches(JobSystemTask task, Span<T> data, size_t batch_size) {
+void job_system_submit_batches(JobGroup* group, JobSystemTask task, Span<T> data, size_t batch_size) {
 	PROFILE_FUNCTION();
 	size_t batch_count = (data.count + batch_size - 1) / batch_size;
 
@@ -29,10 +42,14 @@ void job_system_submit_batches(JobSystemTask task, Span<T> data, size_t batch_si
 		size_t offset = i * batch_size;
 		size_t size = min(batch_size, data.count - offset);
 
-		job_system_submit(task, data.values + offset, size);
+		job_system_submit(group, task, data.values + offset, size);
 	}
 }
 
-void job_system_wait_for_all(Arena& arena, Arena& temp_arena);
+// Executes the jobs of the `group` on the calling thread until all of them have completed.
+//
+// The jobs executed by the calling thread get the `worker_index` equal to the worker count,
+// so only a single thread can wait for a group at a time.
+void job_system_wait_for_group(JobGroup& group, Arena& arena, Arena& temp_arena);
 
 void job_system_shutdown();
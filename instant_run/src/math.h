@@ -87,10 +87,22 @@ inline uint32_t min(uint32_t a, uint32_t b) {
 	return a < b ? a : b;
 }
 
+inline size_t min(size_t a, size_t b) {
+	return a < b ? a : b;
+}
+
 inline float max(float a, float b) {
 	return a < b ? b : a;
 }
 
+inline uint32_t max(uint32_t a, uint32_t b) {
+	return a < b ? b : a;
+}
+
+inline size_t max(size_t a, size_t b) {
+	return a < b ? b : a;
+}
+
 inline Vec2 min(Vec2 a, Vec2 b) {
 	return Vec2 { min(a.x, b.x), min(a.y, b.y) };
 }
@@ -521,6 +521,13 @@ void window_wait_for_events(Window* window) {
 	}
 }
 
+void window_wake_up(Window* window) {
+	if (!PostMessageW(window->handle, WM_NULL, 0, 0)) {
+		log_error(L"failed to post wake up message");
+		platform_log_error_message();
+	}
+}
+
 Span<const WindowEvent> window_get_events(const Window* window) {
 	return Span(window->events, window->event_count);
 }
@@ -1120,6 +1127,11 @@ static bool query_user_sid_string(Arena& allocator, winrt::hstring* out_result)
 
 struct alignas(64) PackageProcessingTaskContext {
 	Span<IAppxFactory*> factories;
+
+	// The strings of the `app_descs` are allocated in the arena of the worker,
+	// they are copied into the caller's arena by the `platform_finish_installed_apps_query`
+	Span<Arena> arenas;
+
 	Span<winrt::Windows::ApplicationModel::Package> packages;
 	Span<InstalledAppDesc> app_descs;
 	uint32_t max_app_descs;
@@ -1258,6 +1270,8 @@ static void task_process_package_batch_experimental(const JobContext& job_contex
 	PackageProcessingTaskContext* context = reinterpret_cast<PackageProcessingTaskContext*>(user_data);
 	IAppxFactory* factory = context->factories[job_context.worker_index];
 
+	Arena& allocator = context->arenas[job_context.worker_index];
+
 	for (const auto& package : context->packages) {
 		std::filesystem::path install_path = package.InstalledPath().c_str();
 		std::filesystem::path manifest_path = install_path / "AppxManifest.xml";
@@ -1275,8 +1289,8 @@ static void task_process_package_batch_experimental(const JobContext& job_contex
 
 			// HACK: After all of the convertions of the URI, it is left with forward slash at the start.
 			//       So get rid of it.
-			logo_uri = wstr_duplicate(logo_uri_string.c_str() + 1, job_context.arena);
-			display_name = wstr_duplicate(package.DisplayName().c_str(), job_context.arena);
+			logo_uri = wstr_duplicate(logo_uri_string.c_str() + 1, allocator);
+			display_name = wstr_duplicate(package.DisplayName().c_str(), allocator);
 		}
 
 		ArenaSavePoint temp = arena_begin_temp(job_context.temp_arena);
@@ -1345,7 +1359,7 @@ static void task_process_package_batch_experimental(const JobContext& job_contex
 						const wchar_t* app_user_model_id = build_full_app_user_model_id(package_name,
 								partial_app_id,
 								app_id,
-								job_context.arena);
+								allocator);
 
 						context->app_descs.count += 1;
 						InstalledAppDesc& desc = context->app_descs[context->app_descs.count - 1];
@@ -1376,7 +1390,7 @@ static void task_process_package_batch(const JobContext& job_context, void* user
 	PackageProcessingTaskContext* context = reinterpret_cast<PackageProcessingTaskContext*>(user_data);
 	IAppxFactory* factory = context->factories[job_context.worker_index];
 
-	Arena& allocator = job_context.arena;
+	Arena& allocator = context->arenas[job_context.worker_index];
 
 	for (const auto& package : context->packages) {
 		std::filesystem::path install_path = package.InstalledPath().c_str();
@@ -1504,6 +1518,8 @@ static void task_process_package_batch(const JobContext& job_context, void* user
 struct InstalledAppsQueryState {
 	uint32_t worker_count;
 	IAppxFactory** factories_per_worker;
+	Arena* arenas_per_worker;
+	JobGroup job_group;
 	Span<std::string_view> key_names;
 	std::vector<winrt::Windows::ApplicationModel::Package> packages;
 	Span<PackageProcessingTaskContext> package_batches;
@@ -1577,6 +1593,11 @@ InstalledAppsQueryState* platform_begin_installed_apps_query(Arena& temp_arena,
 	// All of these are temp allocations, however it is the users resposibility to clear temp arena.
 	query_state->worker_count = job_system_get_worker_count() + 1; // +1 for the main thread
 	query_state->factories_per_worker = arena_alloc_array<IAppxFactory*>(temp_arena, query_state->worker_count);
+	query_state->arenas_per_worker = arena_alloc_array<Arena>(temp_arena, query_state->worker_count);
+
+	for (uint32_t i = 0; i < query_state->worker_count; i++) {
+		query_state->arenas_per_worker[i] = Arena { .capacity = mb_to_bytes(1) };
+	}
 
 	{
 		PROFILE_SCOPE("create factories");
@@ -1617,6 +1638,7 @@ InstalledAppsQueryState* platform_begin_installed_apps_query(Arena& temp_arena,
 
 				PackageProcessingTaskContext& current_batch = query_state->package_batches[batch_index];
 				current_batch.factories = factories_per_worker;
+				current_batch.arenas = Span<Arena>(query_state->arenas_per_worker, query_state->worker_count);
 				current_batch.packages = packages_span.slice(batch_start, current_batch_size);
 				current_batch.app_descs = Span<InstalledAppDesc>(arena_alloc_array<InstalledAppDesc>(temp_arena, max_app_descs_per_batch), 0);
 				current_batch.max_app_descs = max_app_descs_per_batch;
@@ -1627,11 +1649,11 @@ InstalledAppsQueryState* platform_begin_installed_apps_query(Arena& temp_arena,
 		// submit jobs
 		if (experimental) {
 			for (auto& batch : query_state->package_batches) {
-				job_system_submit(task_process_package_batch_experimental, &batch);
+				job_system_submit(&query_state->job_group, task_process_package_batch_experimental, &batch);
 			}
 		} else {
 			for (auto& batch : query_state->package_batches) {
-				job_system_submit(task_process_package_batch, &batch);
+				job_system_submit(&query_state->job_group, task_process_package_batch, &batch);
 			}
 		}
 	} catch (const winrt::hresult_error& e) {
@@ -1650,13 +1672,22 @@ std::vector<InstalledAppDesc> platform_finish_installed_apps_query(InstalledApps
 	std::vector<InstalledAppDesc> apps;
 
 	// wait for all the jobs to complete
-	job_system_wait_for_all(job_execution_arena, job_execution_temp_arena);
+	job_system_wait_for_group(query_state->job_group, job_execution_arena, job_execution_temp_arena);
 
+	// The worker arenas are released below, so the strings are moved into the caller's arena
 	for (const auto& batch : query_state->package_batches) {
 		for (const auto& installed_app : batch.app_descs) {
-			apps.push_back(installed_app);
+			apps.push_back(InstalledAppDesc {
+				.id = wstr_duplicate(installed_app.id, job_execution_arena).data(),
+				.logo_uri = wstr_duplicate(installed_app.logo_uri, job_execution_arena),
+				.display_name = wstr_duplicate(installed_app.display_name, job_execution_arena),
+			});
 		}
-	} 
+	}
+
+	for (uint32_t i = 0; i < query_state->worker_count; i++) {
+		arena_release(query_state->arenas_per_worker[i]);
+	}
 
 	// delete factories
 	{
@@ -1906,6 +1937,290 @@ std::filesystem::path fs_resolve_shortcut(const std::filesystem::path& path) {
 	return {};
 }
 
+bool fs_map_file(const std::filesystem::path& path, MappedFile* out_file) {
+	PROFILE_FUNCTION();
+
+	HANDLE file = CreateFileW(path.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL,
+			nullptr);
+
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER file_size{};
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		platform_log_error_message();
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		platform_log_error_message();
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	*out_file = MappedFile {
+		.data = reinterpret_cast<const uint8_t*>(view),
+		.size = (size_t)file_size.QuadPart,
+		.file_handle = file,
+		.mapping_handle = mapping,
+	};
+
+	return true;
+}
+
+void fs_unmap_file(MappedFile& file) {
+	PROFILE_FUNCTION();
+
+	UnmapViewOfFile(file.data);
+	CloseHandle(file.mapping_handle);
+	CloseHandle(file.file_handle);
+
+	file = {};
+}
+
+//
+// Directory Watcher
+//
+
+static constexpr DWORD DIRECTORY_CHANGES_BUFFER_SIZE = 64 * 1024;
+static constexpr DWORD DIRECTORY_CHANGES_FILTER = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME;
+
+struct WatchedDirectory {
+	std::filesystem::path path;
+	HANDLE handle;
+	OVERLAPPED overlapped;
+
+	// DWORD aligned, filled with `FILE_NOTIFY_INFORMATION` by the `ReadDirectoryChangesW`
+	uint8_t* buffer;
+
+	// The old name of the renamed file is reported right before the new one
+	std::filesystem::path renamed_old_path;
+};
+
+struct DirectoryWatcher {
+	HANDLE stop_event;
+
+	// NOTE: Never resized after the reads were issued, because the `OVERLAPPED` is referenced by the pending reads
+	std::vector<WatchedDirectory> directories;
+};
+
+static bool issue_directory_changes_read(WatchedDirectory& directory) {
+	return ReadDirectoryChangesW(directory.handle,
+			directory.buffer,
+			DIRECTORY_CHANGES_BUFFER_SIZE,
+			TRUE,
+			DIRECTORY_CHANGES_FILTER,
+			nullptr,
+			&directory.overlapped,
+			nullptr);
+}
+
+// Stops watching the directory, for example after it was removed
+static void close_watched_directory(WatchedDirectory& directory) {
+	if (directory.handle == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	if (CancelIoEx(directory.handle, &directory.overlapped)) {
+		// The buffer is in use until the read is cancelled
+		DWORD bytes_transferred = 0;
+		GetOverlappedResult(directory.handle, &directory.overlapped, &bytes_transferred, TRUE);
+	}
+
+	CloseHandle(directory.handle);
+	directory.handle = INVALID_HANDLE_VALUE;
+}
+
+static void read_directory_changes(WatchedDirectory& directory, std::vector<FileChange>& out_changes) {
+	const uint8_t* position = directory.buffer;
+
+	while (true) {
+		const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(position);
+		std::filesystem::path path = directory.path / std::wstring_view(info->FileName, info->FileNameLength / sizeof(WCHAR));
+
+		switch (info->Action) {
+		case FILE_ACTION_ADDED:
+			out_changes.push_back(FileChange { .kind = FileChangeKind::Added, .path = std::move(path) });
+			break;
+		case FILE_ACTION_REMOVED:
+			out_changes.push_back(FileChange { .kind = FileChangeKind::Removed, .path = std::move(path) });
+			break;
+		case FILE_ACTION_RENAMED_OLD_NAME:
+			directory.renamed_old_path = std::move(path);
+			break;
+		case FILE_ACTION_RENAMED_NEW_NAME:
+			out_changes.push_back(FileChange {
+				.kind = FileChangeKind::Renamed,
+				.path = std::move(path),
+				.old_path = std::move(directory.renamed_old_path),
+			});
+			break;
+		}
+
+		if (info->NextEntryOffset == 0) {
+			break;
+		}
+
+		position += info->NextEntryOffset;
+	}
+}
+
+DirectoryWatcher* fs_watch_directories(Arena& allocator, const std::vector<std::filesystem::path>& directories) {
+	PROFILE_FUNCTION();
+
+	// One of the wait objects is the stop event
+	if (directories.size() + 1 > MAXIMUM_WAIT_OBJECTS) {
+		log_error(L"too many directories to watch");
+		return nullptr;
+	}
+
+	DirectoryWatcher* watcher = arena_alloc<DirectoryWatcher>(allocator);
+	new(watcher) DirectoryWatcher();
+
+	watcher->stop_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	watcher->directories.reserve(directories.size());
+
+	for (const std::filesystem::path& path : directories) {
+		HANDLE handle = CreateFileW(path.c_str(),
+				FILE_LIST_DIRECTORY,
+				FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				nullptr,
+				OPEN_EXISTING,
+				FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+				nullptr);
+
+		if (handle == INVALID_HANDLE_VALUE) {
+			log_error(L"failed to watch directory: " + path.wstring());
+			platform_log_error_message();
+			continue;
+		}
+
+		WatchedDirectory& directory = watcher->directories.emplace_back();
+		directory.path = path;
+		directory.handle = handle;
+		directory.overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		directory.buffer = reinterpret_cast<uint8_t*>(arena_alloc_aligned(allocator, DIRECTORY_CHANGES_BUFFER_SIZE, alignof(DWORD)));
+
+		if (!issue_directory_changes_read(directory)) {
+			log_error(L"failed to watch directory: " + path.wstring());
+			platform_log_error_message();
+
+			CloseHandle(directory.handle);
+			CloseHandle(directory.overlapped.hEvent);
+			watcher->directories.pop_back();
+		}
+	}
+
+	if (watcher->directories.empty()) {
+		fs_release_directory_watcher(watcher);
+		return nullptr;
+	}
+
+	return watcher;
+}
+
+bool fs_wait_for_file_changes(DirectoryWatcher* watcher, uint32_t timeout_ms, std::vector<FileChange>& out_changes) {
+	PROFILE_FUNCTION();
+
+	HANDLE wait_handles[MAXIMUM_WAIT_OBJECTS];
+	DWORD wait_handle_count = 0;
+
+	wait_handles[wait_handle_count++] = watcher->stop_event;
+	for (const WatchedDirectory& directory : watcher->directories) {
+		if (directory.handle != INVALID_HANDLE_VALUE) {
+			wait_handles[wait_handle_count++] = directory.overlapped.hEvent;
+		}
+	}
+
+	// NOTE: `WAIT_WITHOUT_TIMEOUT` is the same as `INFINITE`
+	DWORD wait_result = WaitForMultipleObjects(wait_handle_count, wait_handles, FALSE, timeout_ms);
+	if (wait_result == WAIT_TIMEOUT) {
+		return true;
+	}
+
+	if (wait_result == WAIT_FAILED) {
+		platform_log_error_message();
+		return false;
+	}
+
+	if (wait_result == WAIT_OBJECT_0) {
+		return false;
+	}
+
+	// Only the first of the signaled handles is reported, so all of the directories are checked
+	for (WatchedDirectory& directory : watcher->directories) {
+		if (directory.handle == INVALID_HANDLE_VALUE) {
+			continue;
+		}
+
+		DWORD bytes_transferred = 0;
+		if (!GetOverlappedResult(directory.handle, &directory.overlapped, &bytes_transferred, FALSE)) {
+			if (GetLastError() == ERROR_IO_INCOMPLETE) {
+				continue;
+			}
+
+			log_error(L"stopped watching directory: " + directory.path.wstring());
+			platform_log_error_message();
+
+			close_watched_directory(directory);
+			ResetEvent(directory.overlapped.hEvent);
+
+			out_changes.push_back(FileChange { .kind = FileChangeKind::Overflowed });
+			continue;
+		}
+
+		// Zero bytes means that the changes didn't fit into the buffer
+		if (bytes_transferred == 0) {
+			out_changes.push_back(FileChange { .kind = FileChangeKind::Overflowed });
+		} else {
+			read_directory_changes(directory, out_changes);
+		}
+
+		if (!issue_directory_changes_read(directory)) {
+			log_error(L"stopped watching directory: " + directory.path.wstring());
+			platform_log_error_message();
+
+			close_watched_directory(directory);
+			ResetEvent(directory.overlapped.hEvent);
+
+			out_changes.push_back(FileChange { .kind = FileChangeKind::Overflowed });
+		}
+	}
+
+	return true;
+}
+
+void fs_stop_watching_directories(DirectoryWatcher* watcher) {
+	SetEvent(watcher->stop_event);
+}
+
+void fs_release_directory_watcher(DirectoryWatcher* watcher) {
+	PROFILE_FUNCTION();
+
+	for (WatchedDirectory& directory : watcher->directories) {
+		close_watched_directory(directory);
+		CloseHandle(directory.overlapped.hEvent);
+	}
+
+	CloseHandle(watcher->stop_event);
+	watcher->~DirectoryWatcher();
+}
+
 static RunFileResult run_executable_file(const std::filesystem::path& path) {
 	PROFILE_FUNCTION();
 
@@ -159,6 +159,9 @@ bool window_should_close(const Window* window);
 void window_poll_events(Window* window);
 void window_wait_for_events(Window* window);
 
+// Makes the `window_wait_for_events` return, can be called from any thread
+void window_wake_up(Window* window);
+
 Span<const WindowEvent> window_get_events(const Window* window);
 
 UVec2 window_get_framebuffer_size(const Window* window);
@@ -201,6 +204,7 @@ struct InstalledAppsQueryState;
 InstalledAppsQueryState* platform_begin_installed_apps_query(Arena& temp_arena, bool exprimental = false);
 
 // Waits until all the jobs scheduled by `platform_begin_installed_apps_query` and then collects the result.
+// The strings of the result are allocated in the `job_execution_arena`.
 std::vector<InstalledAppDesc> platform_finish_installed_apps_query(InstalledAppsQueryState* query_state,
 		Arena& job_execution_arena,
 		Arena& job_execution_temp_arena);
@@ -227,6 +231,55 @@ Bitmap fs_extract_icon_bitmap(SystemIconHandle icon, Arena& bitmap_allocator);
 Bitmap get_file_icon(const std::filesystem::path& path, Arena& arena);
 std::filesystem::path fs_resolve_shortcut(const std::filesystem::path& path);
 
+struct MappedFile {
+	const uint8_t* data;
+	size_t size;
+
+	void* file_handle;
+	void* mapping_handle;
+};
+
+// Maps the whole file for reading, returns `false` if the file doesn't exist, is empty or can't be mapped
+bool fs_map_file(const std::filesystem::path& path, MappedFile* out_file);
+void fs_unmap_file(MappedFile& file);
+
+enum class FileChangeKind {
+	Added,
+	Removed,
+	Renamed,
+
+	// Some of the changes were lost, the watched directories have to be walked again
+	Overflowed,
+};
+
+struct FileChange {
+	FileChangeKind kind;
+	std::filesystem::path path;
+
+	// Only set for the `FileChangeKind::Renamed`
+	std::filesystem::path old_path;
+};
+
+struct DirectoryWatcher;
+
+static constexpr uint32_t WAIT_WITHOUT_TIMEOUT = UINT32_MAX;
+
+// Watches the files and the subdirectories of the `directories`.
+// Returns `nullptr` if none of the directories can be watched.
+DirectoryWatcher* fs_watch_directories(Arena& allocator, const std::vector<std::filesystem::path>& directories);
+
+// Blocks until some of the files have changed, the `timeout_ms` has passed or the watcher was stopped,
+// then appends the changes to the `out_changes`.
+//
+// Returns `false` once the watcher is stopped.
+bool fs_wait_for_file_changes(DirectoryWatcher* watcher, uint32_t timeout_ms, std::vector<FileChange>& out_changes);
+
+// Makes the `fs_wait_for_file_changes` return `false`, can be called from any thread
+void fs_stop_watching_directories(DirectoryWatcher* watcher);
+
+// Must not be called while some thread is waiting for the changes
+void fs_release_directory_watcher(DirectoryWatcher* watcher);
+
 enum class RunFileResult {
 	Ok,
 	OutOfMemory,
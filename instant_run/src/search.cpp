@@ -0,0 +1,2941 @@
+#include "search.h"
+
+#include "core.h"
+#include "job_system.h"
+#include "log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define SEARCH_SIMD_X64
+
+	#include <immintrin.h>
+
+	#if defined(_WIN32)
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#endif
+
+// Parallel scoring doesn't split the candidates into chunks smaller than this
+static constexpr size_t MIN_SCORING_CHUNK_SIZE = 2048;
+
+// Only this many of the best results are sorted by a query,
+// the rest are sorted in batches of the same size when they are requested.
+static constexpr size_t SORTED_RESULT_BATCH_SIZE = 64;
+
+// Number of candidates scored between the checks whether the query was abandoned
+static constexpr size_t CANCELLATION_CHECK_INTERVAL = 1024;
+
+// Capacity of the pattern strings, so that typing a pattern doesn't reallocate them
+static constexpr size_t RESERVED_PATTERN_LENGTH = 128;
+
+// Capacity of the highlights, enough for the displayed results of the long patterns,
+// so that scrolling through the results doesn't reallocate them
+static constexpr size_t RESERVED_HIGHLIGHT_COUNT = 1024;
+
+// The names are scored by the best alignment of the pattern in the name,
+// which rewards matches at word boundaries and consecutive runs and penalizes gaps between the matches.
+static constexpr int32_t SCORE_MATCH = 16;
+static constexpr int32_t SCORE_GAP_START = -3;
+static constexpr int32_t SCORE_GAP_EXTENSION = -1;
+
+static constexpr int32_t BONUS_BOUNDARY = 8;
+static constexpr int32_t BONUS_CAMEL_CASE = 7;
+static constexpr int32_t BONUS_CONSECUTIVE = 4;
+
+// The bonus of the first pattern character is multiplied by this,
+// so that matching the start of a word is preferred over a tighter match in the middle of one
+static constexpr int32_t BONUS_FIRST_CHAR_MULTIPLIER = 2;
+
+// Per pattern character bonus for patterns that are a run of the name initials, doubled when the run starts the name.
+// Single character patterns don't get it, they are already rewarded by the `BONUS_BOUNDARY`.
+static constexpr int32_t BONUS_ACRONYM = 8;
+static constexpr size_t MIN_ACRONYM_LENGTH = 2;
+
+// Size of the fixed alignment matrix, longer patterns or match windows
+// are scored by the greedy match instead
+static constexpr size_t MAX_ALIGNMENT_PATTERN_LENGTH = 64;
+static constexpr size_t MAX_ALIGNMENT_WINDOW_LENGTH = 256;
+
+//
+// SIMD
+//
+
+enum class SimdLevel {
+	Scalar,
+	SSE2,
+	AVX2,
+};
+
+#ifdef SEARCH_SIMD_X64
+
+static void cpuid(uint32_t leaf, uint32_t sub_leaf, uint32_t* out_registers) {
+#if defined(_WIN32)
+	int registers[4] = {};
+	__cpuidex(registers, (int)leaf, (int)sub_leaf);
+	std::memcpy(out_registers, registers, sizeof(registers));
+#else
+	__cpuid_count(leaf, sub_leaf, out_registers[0], out_registers[1], out_registers[2], out_registers[3]);
+#endif
+}
+
+__attribute__((target("xsave")))
+static uint64_t read_xcr0() {
+	return _xgetbv(0);
+}
+
+static SimdLevel detect_simd_level() {
+	uint32_t registers[4] = {};
+	cpuid(0, 0, registers);
+
+	uint32_t max_leaf = registers[0];
+	if (max_leaf < 7) {
+		return SimdLevel::SSE2;
+	}
+
+	cpuid(1, 0, registers);
+
+	bool has_osxsave = HAS_FLAG(registers[2], 1u << 27);
+	bool has_avx = HAS_FLAG(registers[2], 1u << 28);
+
+	// The OS must save the YMM registers on a context switch
+	if (!has_osxsave || !has_avx || (read_xcr0() & 0x6) != 0x6) {
+		return SimdLevel::SSE2;
+	}
+
+	cpuid(7, 0, registers);
+
+	bool has_avx2 = HAS_FLAG(registers[1], 1u << 5);
+	return has_avx2 ? SimdLevel::AVX2 : SimdLevel::SSE2;
+}
+
+#else
+
+static SimdLevel detect_simd_level() {
+	return SimdLevel::Scalar;
+}
+
+#endif
+
+static SimdLevel get_simd_level() {
+	static const SimdLevel s_simd_level = detect_simd_level();
+	return s_simd_level;
+}
+
+//
+// Launch History
+//
+
+static constexpr uint32_t DAYS_PER_WEEK = 7;
+
+// Halves every two weeks
+static constexpr float LAUNCH_AGE_WEIGHTS[LAUNCH_HISTORY_BUCKET_COUNT] = {
+	1.0f, 0.707f, 0.5f, 0.354f,
+	0.25f, 0.177f, 0.125f, 0.088f,
+	0.0625f, 0.044f, 0.031f, 0.022f,
+	0.0156f, 0.011f, 0.0078f, 0.0055f,
+};
+
+uint32_t launch_history_get_current_week() {
+	auto days = std::chrono::duration_cast<std::chrono::days>(std::chrono::system_clock::now().time_since_epoch());
+	return (uint32_t)(days.count() / DAYS_PER_WEEK);
+}
+
+void launch_history_record_launch(LaunchHistory& history, uint32_t current_week, uint32_t count) {
+	// The clock could have been moved back
+	current_week = max(current_week, history.last_launch_week);
+
+	// Clear the buckets that still contain the launches from `LAUNCH_HISTORY_BUCKET_COUNT` weeks ago
+	uint32_t stale_bucket_count = min(current_week - history.last_launch_week, LAUNCH_HISTORY_BUCKET_COUNT);
+	for (uint32_t i = 0; i < stale_bucket_count; i++) {
+		history.bucket_counts[(current_week - i) % LAUNCH_HISTORY_BUCKET_COUNT] = 0;
+	}
+
+	uint8_t& bucket_count = history.bucket_counts[current_week % LAUNCH_HISTORY_BUCKET_COUNT];
+	bucket_count = (uint8_t)min((uint32_t)bucket_count + count, (uint32_t)UINT8_MAX);
+
+	history.last_launch_week = current_week;
+}
+
+float launch_history_compute_frecency(const LaunchHistory& history, uint32_t current_week) {
+	if (current_week < history.last_launch_week) {
+		current_week = history.last_launch_week;
+	}
+
+	float frecency = 0.0f;
+	for (uint32_t age = current_week - history.last_launch_week; age < LAUNCH_HISTORY_BUCKET_COUNT; age++) {
+		uint32_t bucket_count = history.bucket_counts[(current_week - age) % LAUNCH_HISTORY_BUCKET_COUNT];
+		frecency += (float)bucket_count * LAUNCH_AGE_WEIGHTS[age];
+	}
+
+	return frecency;
+}
+
+//
+// Case Folding
+//
+
+// Only the code units below this are folded by the table, the rest of the BMP is mostly caseless
+static constexpr uint32_t FOLD_TABLE_SIZE = 0x2000;
+
+// Only used for the camel case boundaries, the letters without a case mapping in the table are `None`
+enum class CharClass : uint8_t {
+	None,
+	Lower,
+	Upper,
+	Digit,
+};
+
+struct FoldTable {
+	char16_t chars[FOLD_TABLE_SIZE];
+	CharClass classes[FOLD_TABLE_SIZE];
+};
+
+struct FoldCaseRange {
+	uint32_t first;
+	uint32_t last;
+	int32_t delta;
+};
+
+static constexpr FoldCaseRange FOLD_CASE_RANGES[] = {
+	{ 0x0041, 0x005A, 0x20 }, // Basic Latin
+	{ 0x0391, 0x03A1, 0x20 }, // Greek
+	{ 0x03A3, 0x03AB, 0x20 },
+	{ 0x0400, 0x040F, 0x50 }, // Cyrillic
+	{ 0x0410, 0x042F, 0x20 },
+	{ 0x0531, 0x0556, 0x30 }, // Armenian
+	{ 0x10A0, 0x10C5, 0x1C60 }, // Georgian
+	{ 0x1C90, 0x1CBA, -0x0BC0 },
+};
+
+// Ranges of alternating uppercase and lowercase letters, starting with an uppercase one
+static constexpr FoldCaseRange FOLD_CASE_PAIR_RANGES[] = {
+	{ 0x03D8, 0x03EF, 1 }, // Greek
+	{ 0x0460, 0x0481, 1 }, // Cyrillic
+	{ 0x048A, 0x04BF, 1 },
+	{ 0x04C1, 0x04CE, 1 },
+	{ 0x04D0, 0x052F, 1 },
+};
+
+// Folded Latin-1 Supplement, Latin Extended-A and Latin Extended-B, starting at U+00C0.
+// Letters are lowercased and stripped of the diacritics, including the strokes (`ł`, `đ`, `ø`).
+static constexpr char16_t FOLDED_LATIN[] =
+	u"aaaaaa\u00e6ceeeeiiii" // 00C0
+	u"\u00f0nooooo\u00d7ouuuuy\u00fe\u00df" // 00D0
+	u"aaaaaa\u00e6ceeeeiiii" // 00E0
+	u"\u00f0nooooo\u00f7ouuuuy\u00fey" // 00F0
+	u"aaaaaaccccccccdd" // 0100
+	u"ddeeeeeeeeeegggg" // 0110
+	u"gggghhhhiiiiiiii" // 0120
+	u"ii\u0133\u0133jjkk\u0138llllll\u0140" // 0130
+	u"\u0140llnnnnnn\u0149\u014b\u014boooo" // 0140
+	u"oo\u0153\u0153rrrrrrssssss" // 0150
+	u"ssttttttuuuuuuuu" // 0160
+	u"uuuuwwyyyzzzzzzs" // 0170
+	u"b\u0253\u0183\u0183\u0185\u0185\u0254\u0188\u0188\u0256\u0257\u018c\u018c\u018d\u01dd\u0259" // 0180
+	u"\u025b\u0192\u0192\u0260\u0263\u0195\u0269i\u0199\u0199l\u019b\u026f\u0272\u019e\u0275" // 0190
+	u"oo\u01a3\u01a3\u01a5\u01a5\u0280\u01a8\u01a8\u0283\u01aa\u01ab\u01ad\u01ad\u0288u" // 01A0
+	u"u\u028a\u028b\u01b4\u01b4zz\u0292\u01b9\u01b9\u01ba\u01bb\u01bd\u01bd\u01be\u01bf" // 01B0
+	u"\u01c0\u01c1\u01c2\u01c3\u01c6\u01c6\u01c6\u01c9\u01c9\u01c9\u01cc\u01cc\u01ccaai" // 01C0
+	u"ioouuuuuuuuuu\u01ddaa" // 01D0
+	u"aa\u00e6\u00e6ggggkkoooo\u0292\u0292" // 01E0
+	u"j\u01f3\u01f3\u01f3gg\u0195\u01bfnnaa\u00e6\u00e6oo" // 01F0
+	u"aaaaeeeeiiiioooo" // 0200
+	u"rrrruuuusstt\u021d\u021dhh" // 0210
+	u"\u019e\u0221\u0223\u0223zzaaeeoooooo" // 0220
+	u"ooyy\u0234\u0235\u0236\u0237\u0238\u0239\u2c65ccl\u2c66s" // 0230
+	u"z\u0242\u0242b\u0289\u028c\u0247\u0247jj\u024b\u024brryy"; // 0240
+
+// Folded Latin Extended Additional, starting at U+1E00
+static constexpr char16_t FOLDED_LATIN_EXTENDED_ADDITIONAL[] =
+	u"aabbbbbbccdddddd" // 1E00
+	u"ddddeeeeeeeeeeff" // 1E10
+	u"gghhhhhhhhhhiiii" // 1E20
+	u"kkkkkkllllllllmm" // 1E30
+	u"mmmmnnnnnnnnoooo" // 1E40
+	u"oooopppprrrrrrrr" // 1E50
+	u"sssssssssstttttt" // 1E60
+	u"ttuuuuuuuuuuvvvv" // 1E70
+	u"wwwwwwwwwwxxxxyy" // 1E80
+	u"zzzzzzhtwy\u1e9as\u1e9c\u1e9d\u00df\u1e9f" // 1E90
+	u"aaaaaaaaaaaaaaaa" // 1EA0
+	u"aaaaaaaaeeeeeeee" // 1EB0
+	u"eeeeeeeeiiiioooo" // 1EC0
+	u"oooooooooooooooo" // 1ED0
+	u"oooouuuuuuuuuuuu" // 1EE0
+	u"uuyyyyyyyy\u1efb\u1efb\u1efd\u1efd\u1eff\u1eff"; // 1EF0
+
+// Accented letters outside of the Latin blocks, mapped to their folded base letters.
+//
+// NOTE: `й`, `ї` and `ў` are separate letters of their alphabets rather than accented ones, so they are kept.
+static constexpr char16_t FOLDED_DIACRITICS[][2] = {
+	// Greek
+	{ 0x0386, 0x03B1 }, { 0x0388, 0x03B5 }, { 0x0389, 0x03B7 }, { 0x038A, 0x03B9 },
+	{ 0x038C, 0x03BF }, { 0x038E, 0x03C5 }, { 0x038F, 0x03C9 }, { 0x0390, 0x03B9 },
+	{ 0x03AA, 0x03B9 }, { 0x03AB, 0x03C5 }, { 0x03AC, 0x03B1 }, { 0x03AD, 0x03B5 },
+	{ 0x03AE, 0x03B7 }, { 0x03AF, 0x03B9 }, { 0x03B0, 0x03C5 }, { 0x03C2, 0x03C3 },
+	{ 0x03CA, 0x03B9 }, { 0x03CB, 0x03C5 }, { 0x03CC, 0x03BF }, { 0x03CD, 0x03C5 },
+	{ 0x03CE, 0x03C9 },
+
+	// Cyrillic
+	{ 0x0400, 0x0435 }, { 0x0401, 0x0435 }, { 0x0403, 0x0433 }, { 0x040C, 0x043A },
+	{ 0x040D, 0x0438 }, { 0x0450, 0x0435 }, { 0x0451, 0x0435 }, { 0x0453, 0x0433 },
+	{ 0x045C, 0x043A }, { 0x045D, 0x0438 },
+};
+
+static constexpr FoldTable build_fold_table() {
+	FoldTable table{};
+	for (uint32_t c = 0; c < FOLD_TABLE_SIZE; c++) {
+		table.chars[c] = (char16_t)c;
+	}
+
+	for (uint32_t c = u'0'; c <= u'9'; c++) {
+		table.classes[c] = CharClass::Digit;
+	}
+
+	for (const FoldCaseRange& range : FOLD_CASE_RANGES) {
+		for (uint32_t c = range.first; c <= range.last; c++) {
+			uint32_t lowercase = (uint32_t)((int32_t)c + range.delta);
+			table.chars[c] = (char16_t)lowercase;
+			table.classes[c] = CharClass::Upper;
+
+			// NOTE: The lowercase Georgian letters are past the end of the table
+			if (lowercase < FOLD_TABLE_SIZE) {
+				table.classes[lowercase] = CharClass::Lower;
+			}
+		}
+	}
+
+	for (const FoldCaseRange& range : FOLD_CASE_PAIR_RANGES) {
+		for (uint32_t c = range.first; c < range.last; c += 2) {
+			table.chars[c] = (char16_t)(c + range.delta);
+			table.classes[c] = CharClass::Upper;
+			table.classes[c + range.delta] = CharClass::Lower;
+		}
+	}
+
+	// The folded Latin blocks lose the case, only the Latin-1 Supplement is split into an uppercase and a lowercase half
+	for (uint32_t c = 0x00C0; c <= 0x00FF; c++) {
+		if (c != 0x00D7 && c != 0x00F7) {
+			table.classes[c] = c < 0x00DF ? CharClass::Upper : CharClass::Lower;
+		}
+	}
+
+	// - 1 for the null terminator
+	for (uint32_t i = 0; i < std::size(FOLDED_LATIN) - 1; i++) {
+		table.chars[0x00C0 + i] = FOLDED_LATIN[i];
+	}
+
+	for (uint32_t i = 0; i < std::size(FOLDED_LATIN_EXTENDED_ADDITIONAL) - 1; i++) {
+		table.chars[0x1E00 + i] = FOLDED_LATIN_EXTENDED_ADDITIONAL[i];
+	}
+
+	for (const auto& mapping : FOLDED_DIACRITICS) {
+		table.chars[mapping[0]] = mapping[1];
+	}
+
+	return table;
+}
+
+static constexpr FoldTable FOLD_TABLE = build_fold_table();
+
+static_assert(std::size(FOLDED_LATIN) - 1 == 0x0250 - 0x00C0);
+static_assert(std::size(FOLDED_LATIN_EXTENDED_ADDITIONAL) - 1 == 0x0100);
+static_assert(FOLD_TABLE.chars[u'\u00C9'] == u'e' && FOLD_TABLE.chars[u'\u0141'] == u'l' && FOLD_TABLE.chars[u'\u0416'] == u'\u0436');
+static_assert(FOLD_TABLE.classes[u'a'] == CharClass::Lower && FOLD_TABLE.classes[u'\u0416'] == CharClass::Upper && FOLD_TABLE.classes[u'7'] == CharClass::Digit);
+
+// Unlike `std::iswupper` and the others, doesn't depend on the locale
+inline static CharClass get_char_class(wchar_t c) {
+	uint32_t code_unit = (uint32_t)c;
+	if (code_unit < FOLD_TABLE_SIZE) {
+		return FOLD_TABLE.classes[code_unit];
+	}
+
+	// Fullwidth Latin letters
+	if (code_unit >= 0xFF21 && code_unit <= 0xFF3A) {
+		return CharClass::Upper;
+	}
+
+	if (code_unit >= 0xFF41 && code_unit <= 0xFF5A) {
+		return CharClass::Lower;
+	}
+
+	return CharClass::None;
+}
+
+//
+// Search Corpus
+//
+
+inline static bool is_word_separator(wchar_t c) {
+	switch (c) {
+	case L' ':
+	case L'-':
+	case L'_':
+	case L'.':
+	case L',':
+	case L':':
+	case L'/':
+	case L'\\':
+	case L'(':
+	case L')':
+	case L'[':
+	case L']':
+	case L'&':
+	case L'+':
+		return true;
+	default:
+		return false;
+	}
+}
+
+static uint8_t compute_char_bonus(wchar_t previous, wchar_t c) {
+	if (is_word_separator(c)) {
+		return 0;
+	}
+
+	if (is_word_separator(previous)) {
+		return (uint8_t)BONUS_BOUNDARY;
+	}
+
+	CharClass previous_class = get_char_class(previous);
+	CharClass char_class = get_char_class(c);
+
+	if ((previous_class == CharClass::Lower && char_class == CharClass::Upper)
+			|| (previous_class != CharClass::Digit && char_class == CharClass::Digit)) {
+		return (uint8_t)BONUS_CAMEL_CASE;
+	}
+
+	return 0;
+}
+
+wchar_t search_fold_char(wchar_t c) {
+	uint32_t code_unit = (uint32_t)c;
+	if (code_unit < FOLD_TABLE_SIZE) {
+		return (wchar_t)FOLD_TABLE.chars[code_unit];
+	}
+
+	// Fullwidth Latin letters
+	if (code_unit >= 0xFF21 && code_unit <= 0xFF3A) {
+		return (wchar_t)(code_unit - 0xFF21 + L'a');
+	}
+
+	if (code_unit >= 0xFF41 && code_unit <= 0xFF5A) {
+		return (wchar_t)(code_unit - 0xFF41 + L'a');
+	}
+
+	return c;
+}
+
+void search_fold_string(std::wstring_view string, wchar_t* out_buffer) {
+	for (size_t i = 0; i < string.length(); i++) {
+		out_buffer[i] = search_fold_char(string[i]);
+	}
+}
+
+static std::wstring get_entry_field_text(const Entry& entry, SearchField field) {
+	switch (field) {
+	case SearchField::FileName:
+		return entry.resolved_path.stem().wstring();
+	case SearchField::ParentFolder:
+		return entry.resolved_path.parent_path().filename().wstring();
+	case SearchField::PackageId:
+		if (entry.is_microsoft_store_app && entry.id != nullptr) {
+			return entry.id;
+		}
+
+		return {};
+	}
+
+	return {};
+}
+
+static bool is_folded_equal(std::wstring_view a, std::wstring_view b) {
+	if (a.length() != b.length()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < a.length(); i++) {
+		if (search_fold_char(a[i]) != search_fold_char(b[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Folds the `string` into the `out_chars` and computes the bonuses of its characters,
+// returns the number of characters that start a word or a hump.
+static uint32_t fold_corpus_string(std::wstring_view string, wchar_t* out_chars, uint8_t* out_bonuses) {
+	search_fold_string(string, out_chars);
+
+	// The start of the string counts as a word boundary
+	uint32_t initial_count = 0;
+	wchar_t previous = L' ';
+	for (size_t i = 0; i < string.length(); i++) {
+		uint8_t bonus = compute_char_bonus(previous, string[i]);
+		out_bonuses[i] = bonus;
+		initial_count += bonus != 0;
+		previous = string[i];
+	}
+
+	return initial_count;
+}
+
+void search_corpus_build(SearchCorpus& corpus, const std::vector<Entry>& entries, const SearchFieldWeights& field_weights) {
+	PROFILE_FUNCTION();
+
+	if (corpus.arena.capacity == 0) {
+		corpus.arena.capacity = mb_to_bytes(64);
+	}
+
+	arena_reset(corpus.arena);
+
+	uint32_t field_count = 0;
+	for (uint32_t i = 0; i < SEARCH_FIELD_COUNT; i++) {
+		float weight = field_weights.values[i];
+		if (weight <= 0.0f) {
+			continue;
+		}
+
+		// Keep the fields sorted by the weight
+		uint32_t slot = field_count;
+		while (slot > 0 && corpus.field_weights[slot - 1] < weight) {
+			corpus.fields[slot] = corpus.fields[slot - 1];
+			corpus.field_weights[slot] = corpus.field_weights[slot - 1];
+			slot -= 1;
+		}
+
+		corpus.fields[slot] = (SearchField)i;
+		corpus.field_weights[slot] = min(weight, 1.0f);
+		field_count += 1;
+	}
+
+	uint32_t entry_count = (uint32_t)entries.size();
+
+	// Fields that are the same as the name or one of the previous fields are left empty
+	std::vector<std::wstring> field_texts(entry_count * field_count);
+	if (field_count != 0) {
+		PROFILE_SCOPE("collect_fields");
+
+		for (uint32_t i = 0; i < entry_count; i++) {
+			for (uint32_t slot = 0; slot < field_count; slot++) {
+				std::wstring text = get_entry_field_text(entries[i], corpus.fields[slot]);
+
+				bool is_duplicate = is_folded_equal(text, entries[i].name);
+				for (uint32_t previous_slot = 0; previous_slot < slot; previous_slot++) {
+					is_duplicate |= is_folded_equal(text, field_texts[i * field_count + previous_slot]);
+				}
+
+				if (!is_duplicate) {
+					field_texts[i * field_count + slot] = std::move(text);
+				}
+			}
+		}
+	}
+
+	size_t total_length = 0;
+	for (const Entry& entry : entries) {
+		total_length += entry.name.length();
+	}
+
+	for (const std::wstring& text : field_texts) {
+		total_length += text.length();
+	}
+
+	uint32_t* name_offsets = arena_alloc_array<uint32_t>(corpus.arena, entry_count);
+	uint32_t* name_lengths = arena_alloc_array<uint32_t>(corpus.arena, entry_count);
+	uint32_t* record_lengths = arena_alloc_array<uint32_t>(corpus.arena, entry_count);
+
+	uint32_t* field_lengths[SEARCH_FIELD_COUNT] = {};
+	for (uint32_t slot = 0; slot < field_count; slot++) {
+		field_lengths[slot] = arena_alloc_array<uint32_t>(corpus.arena, entry_count);
+	}
+
+	arena_align_to_cache_line(corpus.arena);
+	uint32_t* char_masks = arena_alloc_array<uint32_t>(corpus.arena, entry_count);
+
+	arena_align_to_cache_line(corpus.arena);
+	wchar_t* names = arena_alloc_array<wchar_t>(corpus.arena, total_length);
+	uint8_t* char_bonuses = arena_alloc_array<uint8_t>(corpus.arena, total_length);
+
+	uint32_t* initial_offsets = arena_alloc_array<uint32_t>(corpus.arena, entry_count);
+	uint32_t* initial_lengths = arena_alloc_array<uint32_t>(corpus.arena, entry_count);
+
+	uint32_t offset = 0;
+	uint32_t total_initial_count = 0;
+	for (uint32_t i = 0; i < entry_count; i++) {
+		const std::wstring& name = entries[i].name;
+
+		// Only the initials of the name are used for matching the acronyms
+		uint32_t initial_count = fold_corpus_string(name, names + offset, char_bonuses + offset);
+
+		name_offsets[i] = offset;
+		name_lengths[i] = (uint32_t)name.length();
+
+		initial_offsets[i] = total_initial_count;
+		initial_lengths[i] = initial_count;
+		total_initial_count += initial_count;
+
+		uint32_t record_length = (uint32_t)name.length();
+		for (uint32_t slot = 0; slot < field_count; slot++) {
+			const std::wstring& text = field_texts[i * field_count + slot];
+			fold_corpus_string(text, names + offset + record_length, char_bonuses + offset + record_length);
+
+			field_lengths[slot][i] = (uint32_t)text.length();
+			record_length += (uint32_t)text.length();
+		}
+
+		record_lengths[i] = record_length;
+		char_masks[i] = search_compute_char_mask(std::wstring_view(names + offset, record_length));
+
+		offset += record_length;
+	}
+
+	// Only the characters with a bonus start a word or a hump
+	wchar_t* initials = arena_alloc_array<wchar_t>(corpus.arena, total_initial_count);
+	for (uint32_t i = 0; i < entry_count; i++) {
+		wchar_t* entry_initials = initials + initial_offsets[i];
+		for (uint32_t j = name_offsets[i]; j < name_offsets[i] + name_lengths[i]; j++) {
+			if (char_bonuses[j] != 0) {
+				*entry_initials = names[j];
+				entry_initials += 1;
+			}
+		}
+	}
+
+	corpus.entry_count = entry_count;
+	corpus.names = names;
+	corpus.name_offsets = name_offsets;
+	corpus.name_lengths = name_lengths;
+	corpus.record_lengths = record_lengths;
+	corpus.field_count = field_count;
+	for (uint32_t slot = 0; slot < SEARCH_FIELD_COUNT; slot++) {
+		corpus.field_lengths[slot] = field_lengths[slot];
+	}
+
+	corpus.char_masks = char_masks;
+	corpus.char_bonuses = char_bonuses;
+	corpus.initials = initials;
+	corpus.initial_offsets = initial_offsets;
+	corpus.initial_lengths = initial_lengths;
+
+	arena_release(corpus.index.arena);
+	corpus.index.block_count = 0;
+	corpus.index.blocks = nullptr;
+	corpus.index.bucket_entry_counts = nullptr;
+}
+
+void search_corpus_release(SearchCorpus& corpus) {
+	arena_release(corpus.arena);
+	arena_release(corpus.index.arena);
+	corpus.index = {};
+
+	corpus.entry_count = 0;
+	corpus.names = nullptr;
+	corpus.name_offsets = nullptr;
+	corpus.name_lengths = nullptr;
+	corpus.record_lengths = nullptr;
+	corpus.field_count = 0;
+	for (uint32_t slot = 0; slot < SEARCH_FIELD_COUNT; slot++) {
+		corpus.field_lengths[slot] = nullptr;
+	}
+
+	corpus.char_masks = nullptr;
+	corpus.char_bonuses = nullptr;
+	corpus.initials = nullptr;
+	corpus.initial_offsets = nullptr;
+	corpus.initial_lengths = nullptr;
+}
+
+//
+// Prefilter
+//
+
+inline static bool char_mask_contains(uint32_t mask, uint32_t pattern_mask) {
+	return (mask & pattern_mask) == pattern_mask;
+}
+
+static uint32_t prefilter_scalar(const uint32_t* masks,
+		uint32_t start,
+		uint32_t end,
+		uint32_t pattern_mask,
+		uint32_t lang_agnostic_pattern_mask,
+		uint32_t* out_indices) {
+	uint32_t count = 0;
+	for (uint32_t i = start; i < end; i++) {
+		out_indices[count] = i;
+		count += char_mask_contains(masks[i], pattern_mask)
+			|| char_mask_contains(masks[i], lang_agnostic_pattern_mask);
+	}
+
+	return count;
+}
+
+#ifdef SEARCH_SIMD_X64
+
+// Appends the indices of set bits in `lanes` offset by `base_index`
+inline static uint32_t write_lane_indices(uint32_t lanes, uint32_t base_index, uint32_t* out_indices) {
+	uint32_t count = 0;
+	while (lanes != 0) {
+		out_indices[count] = base_index + (uint32_t)__builtin_ctz(lanes);
+		count += 1;
+		lanes &= lanes - 1;
+	}
+
+	return count;
+}
+
+static uint32_t prefilter_sse2(const uint32_t* masks,
+		uint32_t entry_count,
+		uint32_t pattern_mask,
+		uint32_t lang_agnostic_pattern_mask,
+		uint32_t* out_indices) {
+	const __m128i pattern = _mm_set1_epi32((int)pattern_mask);
+	const __m128i lang_agnostic_pattern = _mm_set1_epi32((int)lang_agnostic_pattern_mask);
+
+	uint32_t count = 0;
+	uint32_t i = 0;
+	for (; i + 4 <= entry_count; i += 4) {
+		__m128i block = _mm_load_si128(reinterpret_cast<const __m128i*>(masks + i));
+
+		__m128i matches = _mm_or_si128(
+				_mm_cmpeq_epi32(_mm_and_si128(block, pattern), pattern),
+				_mm_cmpeq_epi32(_mm_and_si128(block, lang_agnostic_pattern), lang_agnostic_pattern));
+
+		uint32_t lanes = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(matches));
+		count += write_lane_indices(lanes, i, out_indices + count);
+	}
+
+	count += prefilter_scalar(masks, i, entry_count, pattern_mask, lang_agnostic_pattern_mask, out_indices + count);
+	return count;
+}
+
+__attribute__((target("avx2")))
+static uint32_t prefilter_avx2(const uint32_t* masks,
+		uint32_t entry_count,
+		uint32_t pattern_mask,
+		uint32_t lang_agnostic_pattern_mask,
+		uint32_t* out_indices) {
+	const __m256i pattern = _mm256_set1_epi32((int)pattern_mask);
+	const __m256i lang_agnostic_pattern = _mm256_set1_epi32((int)lang_agnostic_pattern_mask);
+
+	uint32_t count = 0;
+	uint32_t i = 0;
+	for (; i + 8 <= entry_count; i += 8) {
+		__m256i block = _mm256_load_si256(reinterpret_cast<const __m256i*>(masks + i));
+
+		__m256i matches = _mm256_or_si256(
+				_mm256_cmpeq_epi32(_mm256_and_si256(block, pattern), pattern),
+				_mm256_cmpeq_epi32(_mm256_and_si256(block, lang_agnostic_pattern), lang_agnostic_pattern));
+
+		uint32_t lanes = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(matches));
+		count += write_lane_indices(lanes, i, out_indices + count);
+	}
+
+	count += prefilter_scalar(masks, i, entry_count, pattern_mask, lang_agnostic_pattern_mask, out_indices + count);
+	return count;
+}
+
+#endif
+
+uint32_t search_prefilter(const SearchCorpus& corpus,
+		uint32_t pattern_mask,
+		uint32_t lang_agnostic_pattern_mask,
+		uint32_t* out_indices) {
+	PROFILE_FUNCTION();
+
+	switch (get_simd_level()) {
+#ifdef SEARCH_SIMD_X64
+	case SimdLevel::AVX2:
+		return prefilter_avx2(corpus.char_masks, corpus.entry_count, pattern_mask, lang_agnostic_pattern_mask, out_indices);
+	case SimdLevel::SSE2:
+		return prefilter_sse2(corpus.char_masks, corpus.entry_count, pattern_mask, lang_agnostic_pattern_mask, out_indices);
+#endif
+	default:
+		return prefilter_scalar(corpus.char_masks, 0, corpus.entry_count, pattern_mask, lang_agnostic_pattern_mask, out_indices);
+	}
+}
+
+//
+// Search Index
+//
+
+static constexpr uint32_t SEARCH_INDEX_BUCKET_COUNT = 4096;
+static constexpr uint32_t SEARCH_INDEX_BLOCK_SIZE = 16384;
+
+// Only the first pairs of longer patterns are intersected, the scoring rejects the rest of the extra candidates
+static constexpr uint32_t MAX_QUERIED_PAIR_COUNT = 32;
+
+static constexpr uint32_t NO_ENTRY = UINT32_MAX;
+
+struct SearchIndexBlock {
+	uint32_t first_entry;
+	uint32_t entry_count;
+
+	// `SEARCH_INDEX_BUCKET_COUNT + 1` offsets into the `postings`
+	uint32_t* bucket_offsets;
+	uint32_t* bucket_entry_counts;
+
+	// Each entry index is stored as a varint delta from the previous entry index in the bucket plus one
+	uint8_t* postings;
+};
+
+struct IndexBlockTask {
+	const SearchCorpus* corpus;
+	SearchIndexBlock* block;
+};
+
+inline static uint32_t index_pair_bucket(wchar_t a, wchar_t b) {
+	uint32_t hash = ((uint32_t)a * 0x9e3779b1u) ^ ((uint32_t)b * 0x85ebca6bu);
+	return (hash ^ (hash >> 15)) % SEARCH_INDEX_BUCKET_COUNT;
+}
+
+inline static uint32_t varint_size(uint32_t value) {
+	uint32_t size = 1;
+	while (value >= 0x80) {
+		value >>= 7;
+		size += 1;
+	}
+
+	return size;
+}
+
+inline static uint8_t* varint_write(uint8_t* output, uint32_t value) {
+	while (value >= 0x80) {
+		*output++ = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+
+	*output++ = (uint8_t)value;
+	return output;
+}
+
+inline static const uint8_t* varint_read(const uint8_t* input, uint32_t* out_value) {
+	uint32_t value = 0;
+	uint32_t shift = 0;
+	while (*input & 0x80) {
+		value |= (uint32_t)(*input++ & 0x7f) << shift;
+		shift += 7;
+	}
+
+	value |= (uint32_t)(*input++) << shift;
+	*out_value = value;
+	return input;
+}
+
+// Calls the `visit(bucket, delta)` once for every distinct pair bucket of every entry in the block, in entry order.
+//
+// `last_entries` and `seen_chars` are scratch buffers of `SEARCH_INDEX_BUCKET_COUNT` and the longest record length.
+template<typename F>
+static void visit_block_postings(const SearchCorpus& corpus,
+		const SearchIndexBlock& block,
+		uint32_t* last_entries,
+		wchar_t* seen_chars,
+		F&& visit) {
+	for (uint32_t i = 0; i < SEARCH_INDEX_BUCKET_COUNT; i++) {
+		last_entries[i] = NO_ENTRY;
+	}
+
+	for (uint32_t entry_index = block.first_entry; entry_index < block.first_entry + block.entry_count; entry_index++) {
+		std::wstring_view record = search_corpus_get_record(corpus, entry_index);
+
+		// The name and each of the fields are matched separately, so the pairs never span two of them
+		uint32_t segment_start = 0;
+		for (uint32_t segment = 0; segment <= corpus.field_count; segment++) {
+			uint32_t segment_length = segment == 0
+				? corpus.name_lengths[entry_index]
+				: corpus.field_lengths[segment - 1][entry_index];
+
+			uint32_t seen_count = 0;
+			for (wchar_t c : record.substr(segment_start, segment_length)) {
+				bool is_seen = false;
+				for (uint32_t i = 0; i < seen_count; i++) {
+					uint32_t bucket = index_pair_bucket(seen_chars[i], c);
+					is_seen |= seen_chars[i] == c;
+
+					if (last_entries[bucket] == entry_index) {
+						continue;
+					}
+
+					uint32_t base = last_entries[bucket] == NO_ENTRY ? block.first_entry : last_entries[bucket] + 1;
+					visit(bucket, entry_index - base);
+					last_entries[bucket] = entry_index;
+				}
+
+				if (!is_seen) {
+					seen_chars[seen_count] = c;
+					seen_count += 1;
+				}
+			}
+
+			segment_start += segment_length;
+		}
+	}
+}
+
+static uint32_t get_max_record_length(const SearchCorpus& corpus, const SearchIndexBlock& block) {
+	uint32_t max_length = 0;
+	for (uint32_t i = block.first_entry; i < block.first_entry + block.entry_count; i++) {
+		max_length = max(max_length, corpus.record_lengths[i]);
+	}
+
+	return max_length;
+}
+
+// Computes the size of every bucket in the block, so that the postings can be allocated up front
+static void index_block_count_task(const JobContext& context, void* user_data) {
+	PROFILE_FUNCTION();
+
+	for (IndexBlockTask& task : Span(reinterpret_cast<IndexBlockTask*>(user_data), context.batch_size)) {
+		SearchIndexBlock& block = *task.block;
+
+		uint32_t* last_entries = arena_alloc_array<uint32_t>(context.temp_arena, SEARCH_INDEX_BUCKET_COUNT);
+		wchar_t* seen_chars = arena_alloc_array<wchar_t>(context.temp_arena, get_max_record_length(*task.corpus, block));
+
+		std::memset(block.bucket_entry_counts, 0, sizeof(uint32_t) * SEARCH_INDEX_BUCKET_COUNT);
+		std::memset(block.bucket_offsets, 0, sizeof(uint32_t) * (SEARCH_INDEX_BUCKET_COUNT + 1));
+
+		// Sizes are accumulated in the next offset, then turned into offsets with a prefix sum
+		visit_block_postings(*task.corpus, block, last_entries, seen_chars, [&](uint32_t bucket, uint32_t delta) {
+			block.bucket_entry_counts[bucket] += 1;
+			block.bucket_offsets[bucket + 1] += varint_size(delta);
+		});
+
+		for (uint32_t i = 0; i < SEARCH_INDEX_BUCKET_COUNT; i++) {
+			block.bucket_offsets[i + 1] += block.bucket_offsets[i];
+		}
+	}
+}
+
+static void index_block_write_task(const JobContext& context, void* user_data) {
+	PROFILE_FUNCTION();
+
+	for (IndexBlockTask& task : Span(reinterpret_cast<IndexBlockTask*>(user_data), context.batch_size)) {
+		SearchIndexBlock& block = *task.block;
+
+		uint32_t* last_entries = arena_alloc_array<uint32_t>(context.temp_arena, SEARCH_INDEX_BUCKET_COUNT);
+		wchar_t* seen_chars = arena_alloc_array<wchar_t>(context.temp_arena, get_max_record_length(*task.corpus, block));
+
+		uint32_t* write_offsets = arena_alloc_array<uint32_t>(context.temp_arena, SEARCH_INDEX_BUCKET_COUNT);
+		std::memcpy(write_offsets, block.bucket_offsets, sizeof(uint32_t) * SEARCH_INDEX_BUCKET_COUNT);
+
+		visit_block_postings(*task.corpus, block, last_entries, seen_chars, [&](uint32_t bucket, uint32_t delta) {
+			uint8_t* output = block.postings + write_offsets[bucket];
+			write_offsets[bucket] = (uint32_t)(varint_write(output, delta) - block.postings);
+		});
+	}
+}
+
+void search_corpus_build_index(SearchCorpus& corpus, Arena& arena, Arena& temp_arena) {
+	PROFILE_FUNCTION();
+
+	SearchIndex& index = corpus.index;
+	arena_release(index.arena);
+
+	index.block_count = (corpus.entry_count + SEARCH_INDEX_BLOCK_SIZE - 1) / SEARCH_INDEX_BLOCK_SIZE;
+	index.blocks = nullptr;
+	index.bucket_entry_counts = nullptr;
+
+	if (index.block_count == 0) {
+		return;
+	}
+
+	// The blocks are filled by the jobs, so they live in the `temp_arena`
+	// until the exact size of the index is known
+	ArenaSavePoint temp = arena_begin_temp(temp_arena);
+
+	Span<SearchIndexBlock> blocks = arena_alloc_span<SearchIndexBlock>(temp_arena, index.block_count);
+	Span<IndexBlockTask> tasks = arena_alloc_span<IndexBlockTask>(temp_arena, index.block_count);
+
+	for (uint32_t i = 0; i < index.block_count; i++) {
+		SearchIndexBlock& block = blocks[i];
+		block.first_entry = i * SEARCH_INDEX_BLOCK_SIZE;
+		block.entry_count = min(SEARCH_INDEX_BLOCK_SIZE, corpus.entry_count - block.first_entry);
+		block.bucket_offsets = arena_alloc_array<uint32_t>(temp_arena, SEARCH_INDEX_BUCKET_COUNT + 1);
+		block.bucket_entry_counts = arena_alloc_array<uint32_t>(temp_arena, SEARCH_INDEX_BUCKET_COUNT);
+		block.postings = nullptr;
+
+		tasks[i] = IndexBlockTask { .corpus = &corpus, .block = &block };
+	}
+
+	JobGroup job_group{};
+	job_system_submit_batches(&job_group, index_block_count_task, tasks, 1);
+	job_system_wait_for_group(job_group, arena, temp_arena);
+
+	size_t postings_size = 0;
+	for (const SearchIndexBlock& block : blocks) {
+		postings_size += block.bucket_offsets[SEARCH_INDEX_BUCKET_COUNT];
+	}
+
+	size_t tables_size = index.block_count * (sizeof(SearchIndexBlock) + sizeof(uint32_t) * (2 * SEARCH_INDEX_BUCKET_COUNT + 1));
+	index.arena.capacity = postings_size + tables_size + sizeof(uint32_t) * SEARCH_INDEX_BUCKET_COUNT + mb_to_bytes(1);
+
+	SearchIndexBlock* index_blocks = arena_alloc_array<SearchIndexBlock>(index.arena, index.block_count);
+	uint32_t* bucket_entry_counts = arena_alloc_array<uint32_t>(index.arena, SEARCH_INDEX_BUCKET_COUNT);
+	std::memset(bucket_entry_counts, 0, sizeof(uint32_t) * SEARCH_INDEX_BUCKET_COUNT);
+
+	for (uint32_t i = 0; i < index.block_count; i++) {
+		SearchIndexBlock& block = index_blocks[i];
+		block = blocks[i];
+
+		block.bucket_offsets = arena_alloc_array<uint32_t>(index.arena, SEARCH_INDEX_BUCKET_COUNT + 1);
+		std::memcpy(block.bucket_offsets, blocks[i].bucket_offsets, sizeof(uint32_t) * (SEARCH_INDEX_BUCKET_COUNT + 1));
+
+		block.bucket_entry_counts = arena_alloc_array<uint32_t>(index.arena, SEARCH_INDEX_BUCKET_COUNT);
+		std::memcpy(block.bucket_entry_counts, blocks[i].bucket_entry_counts, sizeof(uint32_t) * SEARCH_INDEX_BUCKET_COUNT);
+
+		block.postings = arena_alloc_array<uint8_t>(index.arena, block.bucket_offsets[SEARCH_INDEX_BUCKET_COUNT]);
+
+		for (uint32_t bucket = 0; bucket < SEARCH_INDEX_BUCKET_COUNT; bucket++) {
+			bucket_entry_counts[bucket] += block.bucket_entry_counts[bucket];
+		}
+
+		tasks[i].block = &block;
+	}
+
+	job_system_submit_batches(&job_group, index_block_write_task, tasks, 1);
+	job_system_wait_for_group(job_group, arena, temp_arena);
+
+	arena_end_temp(temp);
+
+	index.blocks = index_blocks;
+	index.bucket_entry_counts = bucket_entry_counts;
+
+	{
+		ArenaSavePoint temp = arena_begin_temp(temp_arena);
+		StringBuilder<wchar_t> builder = { &temp_arena };
+		str_builder_append<wchar_t>(builder, L"built the search index: ");
+		str_builder_append<wchar_t>(builder, std::to_wstring(postings_size / 1024));
+		str_builder_append<wchar_t>(builder, L" KB of postings");
+
+		log_info(str_builder_to_str(builder));
+		arena_end_temp(temp);
+	}
+}
+
+// Iterates the entries of a single bucket across all of the blocks
+struct PostingCursor {
+	const SearchIndex* index;
+	uint32_t bucket;
+	uint32_t block_index;
+
+	const uint8_t* read;
+	const uint8_t* end;
+	uint32_t base;
+};
+
+static PostingCursor posting_cursor_begin(const SearchIndex& index, uint32_t bucket) {
+	PostingCursor cursor{};
+	cursor.index = &index;
+	cursor.bucket = bucket;
+	cursor.block_index = UINT32_MAX;
+	return cursor;
+}
+
+static bool posting_cursor_next(PostingCursor& cursor, uint32_t* out_entry) {
+	while (cursor.read == cursor.end) {
+		cursor.block_index += 1;
+		if (cursor.block_index >= cursor.index->block_count) {
+			return false;
+		}
+
+		const SearchIndexBlock& block = cursor.index->blocks[cursor.block_index];
+		cursor.read = block.postings + block.bucket_offsets[cursor.bucket];
+		cursor.end = block.postings + block.bucket_offsets[cursor.bucket + 1];
+		cursor.base = block.first_entry;
+	}
+
+	uint32_t delta = 0;
+	cursor.read = varint_read(cursor.read, &delta);
+
+	*out_entry = cursor.base + delta;
+	cursor.base = *out_entry + 1;
+	return true;
+}
+
+// Intersects the postings of all the pattern pairs, starting from the smallest one
+static uint32_t index_query_pattern(const SearchIndex& index, std::wstring_view pattern, uint32_t* out_indices) {
+	assert(pattern.length() >= 2);
+
+	uint32_t bucket_count = 0;
+	uint32_t buckets[MAX_QUERIED_PAIR_COUNT] = {};
+
+	for (size_t i = 0; i + 1 < pattern.length() && bucket_count < MAX_QUERIED_PAIR_COUNT; i++) {
+		uint32_t bucket = index_pair_bucket(pattern[i], pattern[i + 1]);
+		if (std::find(buckets, buckets + bucket_count, bucket) == buckets + bucket_count) {
+			buckets[bucket_count] = bucket;
+			bucket_count += 1;
+		}
+	}
+
+	// The pattern has at least one pair
+	assert(bucket_count > 0);
+
+	std::sort(buckets, buckets + bucket_count, [&](uint32_t a, uint32_t b) {
+		return index.bucket_entry_counts[a] < index.bucket_entry_counts[b];
+	});
+
+	uint32_t count = 0;
+	{
+		PostingCursor cursor = posting_cursor_begin(index, buckets[0]);
+		uint32_t entry_index = 0;
+		while (posting_cursor_next(cursor, &entry_index)) {
+			out_indices[count] = entry_index;
+			count += 1;
+		}
+	}
+
+	for (uint32_t i = 1; i < bucket_count && count != 0; i++) {
+		PostingCursor cursor = posting_cursor_begin(index, buckets[i]);
+
+		uint32_t entry_index = 0;
+		bool has_entry = posting_cursor_next(cursor, &entry_index);
+
+		uint32_t read_index = 0;
+		uint32_t write_index = 0;
+		while (read_index < count && has_entry) {
+			if (out_indices[read_index] < entry_index) {
+				read_index += 1;
+			} else if (out_indices[read_index] > entry_index) {
+				has_entry = posting_cursor_next(cursor, &entry_index);
+			} else {
+				out_indices[write_index] = entry_index;
+				write_index += 1;
+				read_index += 1;
+				has_entry = posting_cursor_next(cursor, &entry_index);
+			}
+		}
+
+		count = write_index;
+	}
+
+	return count;
+}
+
+bool search_index_query(const SearchCorpus& corpus,
+		std::wstring_view folded_pattern,
+		std::wstring_view folded_lang_agnostic_pattern,
+		uint32_t* out_indices,
+		uint32_t* out_count,
+		Arena& temp_arena) {
+	PROFILE_FUNCTION();
+
+	const SearchIndex& index = corpus.index;
+	if (index.blocks == nullptr || folded_pattern.length() < 2 || folded_lang_agnostic_pattern.length() < 2) {
+		return false;
+	}
+
+	if (folded_pattern == folded_lang_agnostic_pattern) {
+		*out_count = index_query_pattern(index, folded_pattern, out_indices);
+		return true;
+	}
+
+	ArenaSavePoint temp = arena_begin_temp(temp_arena);
+
+	uint32_t* indices = arena_alloc_array<uint32_t>(temp_arena, corpus.entry_count);
+	uint32_t* lang_agnostic_indices = arena_alloc_array<uint32_t>(temp_arena, corpus.entry_count);
+
+	uint32_t count = index_query_pattern(index, folded_pattern, indices);
+	uint32_t lang_agnostic_count = index_query_pattern(index, folded_lang_agnostic_pattern, lang_agnostic_indices);
+
+	uint32_t* end = std::set_union(indices, indices + count,
+			lang_agnostic_indices, lang_agnostic_indices + lang_agnostic_count,
+			out_indices);
+
+	*out_count = (uint32_t)(end - out_indices);
+
+	arena_end_temp(temp);
+	return true;
+}
+
+//
+// Query History
+//
+
+// Every launch of the entry after typing the same prefix adds this to the score,
+// only the first `MAX_BOOSTED_QUERY_LAUNCH_COUNT` launches are counted
+static constexpr float QUERY_LAUNCH_BONUS = 2.0f * SCORE_MATCH;
+static constexpr uint32_t MAX_BOOSTED_QUERY_LAUNCH_COUNT = 8;
+
+// FNV-1a, the prefix hashes are persisted, so they must not change between the runs
+static constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+static constexpr uint64_t FNV_PRIME = 0x100000001b3;
+
+inline static uint64_t hash_pattern_char(uint64_t hash, wchar_t c) {
+	return (hash ^ (uint64_t)c) * FNV_PRIME;
+}
+
+static uint64_t hash_query_prefix(std::wstring_view folded_pattern) {
+	size_t prefix_length = min(folded_pattern.length(), (size_t)MAX_QUERY_HISTORY_PREFIX_LENGTH);
+
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < prefix_length; i++) {
+		hash = hash_pattern_char(hash, folded_pattern[i]);
+	}
+
+	return hash;
+}
+
+inline static uint32_t get_query_history_bucket_index(uint64_t prefix_hash, uint32_t entry_index) {
+	uint64_t hash = prefix_hash ^ ((uint64_t)entry_index * 0x9e3779b97f4a7c15);
+	hash ^= hash >> 32;
+	return (uint32_t)(hash % QUERY_HISTORY_BUCKET_COUNT);
+}
+
+// Returns the slot of the association if it is stored, otherwise the slot that should be replaced by it
+static QueryHistorySlot& find_query_history_slot(QueryHistory& history, uint64_t prefix_hash, uint32_t entry_index) {
+	QueryHistorySlot* bucket = history.slots + get_query_history_bucket_index(prefix_hash, entry_index) * QUERY_HISTORY_BUCKET_SIZE;
+	QueryHistorySlot* replaced_slot = bucket;
+
+	for (uint32_t i = 0; i < QUERY_HISTORY_BUCKET_SIZE; i++) {
+		QueryHistorySlot& slot = bucket[i];
+		if (slot.launch_count != 0 && slot.prefix_hash == prefix_hash && slot.entry_index == entry_index) {
+			return slot;
+		}
+
+		// Empty slots first, then the least recently launched one
+		if (replaced_slot->launch_count != 0
+				&& (slot.launch_count == 0 || slot.last_launch < replaced_slot->last_launch)) {
+			replaced_slot = &slot;
+		}
+	}
+
+	return *replaced_slot;
+}
+
+static void query_history_record_prefix_launch(QueryHistory& history, uint64_t prefix_hash, uint32_t entry_index) {
+	QueryHistorySlot& slot = find_query_history_slot(history, prefix_hash, entry_index);
+	if (slot.launch_count != 0 && slot.prefix_hash == prefix_hash && slot.entry_index == entry_index) {
+		if (slot.launch_count != UINT32_MAX) {
+			slot.launch_count += 1;
+		}
+	} else {
+		slot.prefix_hash = prefix_hash;
+		slot.entry_index = entry_index;
+		slot.launch_count = 1;
+	}
+
+	slot.last_launch = history.launch_counter;
+}
+
+void query_history_record_launch(QueryHistory& history,
+		std::wstring_view folded_pattern,
+		std::wstring_view folded_lang_agnostic_pattern,
+		uint32_t entry_index) {
+	PROFILE_FUNCTION();
+
+	history.launch_counter += 1;
+
+	uint64_t prefix_hash = FNV_OFFSET_BASIS;
+	uint64_t lang_agnostic_prefix_hash = FNV_OFFSET_BASIS;
+
+	for (size_t i = 0; i < MAX_QUERY_HISTORY_PREFIX_LENGTH; i++) {
+		bool has_pattern_char = i < folded_pattern.length();
+		bool has_lang_agnostic_char = i < folded_lang_agnostic_pattern.length();
+		if (!has_pattern_char && !has_lang_agnostic_char) {
+			break;
+		}
+
+		if (has_pattern_char) {
+			prefix_hash = hash_pattern_char(prefix_hash, folded_pattern[i]);
+			query_history_record_prefix_launch(history, prefix_hash, entry_index);
+		}
+
+		if (has_lang_agnostic_char) {
+			lang_agnostic_prefix_hash = hash_pattern_char(lang_agnostic_prefix_hash, folded_lang_agnostic_pattern[i]);
+
+			// The prefixes are usually the same, in that case the launch is only counted once
+			if (!has_pattern_char || lang_agnostic_prefix_hash != prefix_hash) {
+				query_history_record_prefix_launch(history, lang_agnostic_prefix_hash, entry_index);
+			}
+		}
+	}
+}
+
+void query_history_restore_slot(QueryHistory& history, const QueryHistorySlot& slot) {
+	if (slot.launch_count == 0) {
+		return;
+	}
+
+	find_query_history_slot(history, slot.prefix_hash, slot.entry_index) = slot;
+	history.launch_counter = max(history.launch_counter, slot.last_launch);
+}
+
+void query_history_remap_entries(QueryHistory& history, Span<const uint32_t> new_entry_indices) {
+	PROFILE_FUNCTION();
+
+	// The bucket of a slot depends on the entry index, so the remapped slots are reinserted
+	std::vector<QueryHistorySlot> slots(std::begin(history.slots), std::end(history.slots));
+	std::fill(std::begin(history.slots), std::end(history.slots), QueryHistorySlot{});
+
+	for (QueryHistorySlot slot : slots) {
+		if (slot.launch_count == 0 || slot.entry_index >= new_entry_indices.count) {
+			continue;
+		}
+
+		uint32_t new_entry_index = new_entry_indices[slot.entry_index];
+		if (new_entry_index == UINT32_MAX) {
+			continue;
+		}
+
+		slot.entry_index = new_entry_index;
+		query_history_restore_slot(history, slot);
+	}
+}
+
+static uint32_t query_history_get_launch_count(const QueryHistory& history, uint64_t prefix_hash, uint32_t entry_index) {
+	const QueryHistorySlot* bucket = history.slots + get_query_history_bucket_index(prefix_hash, entry_index) * QUERY_HISTORY_BUCKET_SIZE;
+	for (uint32_t i = 0; i < QUERY_HISTORY_BUCKET_SIZE; i++) {
+		const QueryHistorySlot& slot = bucket[i];
+		if (slot.launch_count != 0 && slot.prefix_hash == prefix_hash && slot.entry_index == entry_index) {
+			return slot.launch_count;
+		}
+	}
+
+	return 0;
+}
+
+// Hashes of the query prefixes, which are looked up for every matched entry
+struct QueryPrefixHashes {
+	uint64_t values[2];
+	uint32_t count;
+};
+
+static QueryPrefixHashes compute_query_prefix_hashes(std::wstring_view folded_pattern, std::wstring_view folded_lang_agnostic_pattern) {
+	QueryPrefixHashes hashes{};
+	if (!folded_pattern.empty()) {
+		hashes.values[hashes.count] = hash_query_prefix(folded_pattern);
+		hashes.count += 1;
+	}
+
+	if (!folded_lang_agnostic_pattern.empty()) {
+		uint64_t hash = hash_query_prefix(folded_lang_agnostic_pattern);
+		if (hashes.count == 0 || hashes.values[0] != hash) {
+			hashes.values[hashes.count] = hash;
+			hashes.count += 1;
+		}
+	}
+
+	return hashes;
+}
+
+//
+// Searching
+//
+
+struct SearchScore {
+	uint32_t value;
+	uint32_t highlight_range_count;
+	bool is_full_match;
+};
+
+static constexpr int32_t SCORE_NONE = INT32_MIN / 2;
+static constexpr uint16_t NO_ORIGIN = UINT16_MAX;
+
+// Buffers used for scoring a single name, allocated once per chunk
+struct ScoringScratch {
+	// MAX_ALIGNMENT_PATTERN_LENGTH x MAX_ALIGNMENT_WINDOW_LENGTH
+	int32_t* alignment_scores;
+	// Column of the previous pattern character for each matched cell
+	uint16_t* alignment_origins;
+
+	// Matched positions of the characters of both patterns
+	uint32_t* positions;
+};
+
+static ScoringScratch scoring_scratch_alloc(Arena& arena, size_t total_pattern_length) {
+	constexpr size_t matrix_size = MAX_ALIGNMENT_PATTERN_LENGTH * MAX_ALIGNMENT_WINDOW_LENGTH;
+
+	ScoringScratch scratch{};
+	scratch.alignment_scores = arena_alloc_array<int32_t>(arena, matrix_size);
+	scratch.alignment_origins = arena_alloc_array<uint16_t>(arena, matrix_size);
+	scratch.positions = arena_alloc_array<uint32_t>(arena, max(total_pattern_length, (size_t)1));
+	return scratch;
+}
+
+// Greedy forward scan for both patterns at once, so that the `string` is only read a single time.
+//
+// Writes the match positions of each pattern, returns the number of matched characters of each pattern.
+static void find_forward_matches(std::wstring_view string,
+		std::wstring_view pattern,
+		std::wstring_view lang_agnostic_pattern,
+		uint32_t* positions,
+		uint32_t* lang_agnostic_positions,
+		size_t* out_match_count,
+		size_t* out_lang_agnostic_match_count) {
+	size_t pattern_index = 0;
+	size_t lang_agnostic_pattern_index = 0;
+
+	for (size_t i = 0; i < string.length(); i++) {
+		wchar_t c = string[i];
+
+		if (pattern_index < pattern.length() && c == pattern[pattern_index]) {
+			positions[pattern_index] = (uint32_t)i;
+			pattern_index += 1;
+		}
+
+		if (lang_agnostic_pattern_index < lang_agnostic_pattern.length() && c == lang_agnostic_pattern[lang_agnostic_pattern_index]) {
+			lang_agnostic_positions[lang_agnostic_pattern_index] = (uint32_t)i;
+			lang_agnostic_pattern_index += 1;
+		}
+
+		if (pattern_index == pattern.length() && lang_agnostic_pattern_index == lang_agnostic_pattern.length()) {
+			break;
+		}
+	}
+
+	*out_match_count = pattern_index;
+	*out_lang_agnostic_match_count = lang_agnostic_pattern_index;
+}
+
+// Returns the end of the window that can contain the best alignment of the `pattern`,
+// which is right after the last occurrence of the last pattern character.
+//
+// The `pattern` must be a subsequence of the `string`, so the forward match already ends at or before that occurrence.
+static size_t find_match_window_end(std::wstring_view string, std::wstring_view pattern) {
+	size_t end = string.length();
+	while (string[end - 1] != pattern.back()) {
+		end -= 1;
+	}
+
+	return end;
+}
+
+// Scores the matched `positions` with the same rules as the alignment
+static int32_t score_match_positions(const uint8_t* char_bonuses, const uint32_t* positions, size_t count) {
+	int32_t score = 0;
+	for (size_t i = 0; i < count; i++) {
+		int32_t bonus = (int32_t)char_bonuses[positions[i]];
+		if (i == 0) {
+			score += SCORE_MATCH + bonus * BONUS_FIRST_CHAR_MULTIPLIER;
+			continue;
+		}
+
+		uint32_t gap = positions[i] - positions[i - 1] - 1;
+		if (gap == 0) {
+			score += SCORE_MATCH + bonus + BONUS_CONSECUTIVE;
+		} else {
+			score += SCORE_MATCH + bonus + SCORE_GAP_START + SCORE_GAP_EXTENSION * (int32_t)(gap - 1);
+		}
+	}
+
+	return score;
+}
+
+// Finds the best scoring alignment of the `pattern` inside the `string[window_start..window_start + window_length]`.
+//
+// `M[i][j]` is the best score of matching `pattern[0..i]` with the `pattern[i]` matched at the column `j`.
+// A match either extends a consecutive run from `M[i - 1][j - 1]`,
+// or follows the best `M[i - 1][k]` for `k < j - 1` minus the affine gap penalty,
+// which is carried along the row instead of scanning all the `k`.
+//
+// Returns the alignment score. When `write_positions` is set, backtracks the best alignment
+// and writes the positions of the matched characters into `out_positions`.
+static int32_t compute_alignment(std::wstring_view string,
+		const uint8_t* char_bonuses,
+		std::wstring_view pattern,
+		size_t window_start,
+		size_t window_length,
+		const ScoringScratch& scratch,
+		uint32_t* out_positions,
+		bool write_positions) {
+	const size_t width = window_length;
+	const wchar_t* window = string.data() + window_start;
+	const uint8_t* window_bonuses = char_bonuses + window_start;
+
+	for (size_t i = 0; i < pattern.length(); i++) {
+		int32_t* row = scratch.alignment_scores + i * width;
+		uint16_t* origins = scratch.alignment_origins + i * width;
+		const int32_t* previous_row = row - width;
+
+		int32_t gap_score = SCORE_NONE;
+		uint16_t gap_origin = NO_ORIGIN;
+
+		wchar_t pattern_char = pattern[i];
+		for (size_t j = 0; j < width; j++) {
+			if (i > 0 && j >= 2) {
+				gap_score += SCORE_GAP_EXTENSION;
+
+				int32_t gap_start_score = previous_row[j - 2] + SCORE_GAP_START;
+				if (gap_start_score > gap_score) {
+					gap_score = gap_start_score;
+					gap_origin = (uint16_t)(j - 2);
+				}
+			}
+
+			if (window[j] != pattern_char) {
+				row[j] = SCORE_NONE;
+				continue;
+			}
+
+			int32_t bonus = (int32_t)window_bonuses[j];
+			if (i == 0) {
+				row[j] = SCORE_MATCH + bonus * BONUS_FIRST_CHAR_MULTIPLIER;
+				origins[j] = NO_ORIGIN;
+				continue;
+			}
+
+			int32_t best_score = SCORE_NONE;
+			uint16_t origin = NO_ORIGIN;
+
+			// Consecutive matches win the ties, so that highlights are not fragmented
+			if (j >= 1 && previous_row[j - 1] > SCORE_NONE) {
+				best_score = previous_row[j - 1] + BONUS_CONSECUTIVE;
+				origin = (uint16_t)(j - 1);
+			}
+
+			if (gap_score > best_score && gap_score > SCORE_NONE / 2) {
+				best_score = gap_score;
+				origin = gap_origin;
+			}
+
+			if (origin == NO_ORIGIN) {
+				row[j] = SCORE_NONE;
+				continue;
+			}
+
+			row[j] = best_score + SCORE_MATCH + bonus;
+			origins[j] = origin;
+		}
+	}
+
+	const int32_t* last_row = scratch.alignment_scores + (pattern.length() - 1) * width;
+
+	size_t best_column = 0;
+	int32_t best_score = SCORE_NONE;
+	for (size_t j = 0; j < width; j++) {
+		if (last_row[j] > best_score) {
+			best_score = last_row[j];
+			best_column = j;
+		}
+	}
+
+	assert(best_score > SCORE_NONE);
+
+	if (!write_positions) {
+		return best_score;
+	}
+
+	size_t column = best_column;
+	for (size_t i = pattern.length(); i > 0; i--) {
+		out_positions[i - 1] = (uint32_t)(window_start + column);
+		column = scratch.alignment_origins[(i - 1) * width + column];
+	}
+
+	return best_score;
+}
+
+// Scores a `pattern` whose greedy forward match is in `positions`.
+//
+// When `write_positions` is set, the `positions` are replaced with the positions of the best alignment.
+static uint32_t score_forward_match(std::wstring_view string,
+		const uint8_t* char_bonuses,
+		std::wstring_view pattern,
+		uint32_t* positions,
+		const ScoringScratch& scratch,
+		bool write_positions) {
+	if (pattern.empty()) {
+		return 0;
+	}
+
+	size_t window_start = positions[0];
+	size_t window_length = find_match_window_end(string, pattern) - window_start;
+
+	int32_t score = 0;
+	if (pattern.length() <= MAX_ALIGNMENT_PATTERN_LENGTH && window_length <= MAX_ALIGNMENT_WINDOW_LENGTH) {
+		score = compute_alignment(string, char_bonuses, pattern, window_start, window_length, scratch, positions, write_positions);
+	} else {
+		// Fallback to the greedy forward match
+		score = score_match_positions(char_bonuses, positions, pattern.length());
+	}
+
+	// Very sparse matches can be penalized below zero, keep them above the names that didn't match
+	return score > 0 ? (uint32_t)score : 1;
+}
+
+static uint32_t write_highlight_ranges(const uint32_t* positions, size_t count, RangeU32* out_ranges) {
+	uint32_t highlight_count = 0;
+	for (size_t i = 0; i < count; i++) {
+		uint32_t position = positions[i];
+		if (highlight_count > 0) {
+			RangeU32& last_range = out_ranges[highlight_count - 1];
+			if (last_range.start + last_range.count == position) {
+				last_range.count += 1;
+				continue;
+			}
+		}
+
+		out_ranges[highlight_count] = RangeU32 { position, 1 };
+		highlight_count += 1;
+	}
+
+	return highlight_count;
+}
+
+//
+// Short Pattern Kernels
+//
+
+// Patterns up to this length are scored by the kernels specialized for their length,
+// most of the queries are only a few characters long
+static constexpr size_t MAX_SHORT_PATTERN_LENGTH = 8;
+
+// Returns the index of the first `c` in the `string[start..]`, or the `string.length()` if there is none
+static size_t find_char(std::wstring_view string, size_t start, wchar_t c) {
+	size_t i = start;
+
+#ifdef SEARCH_SIMD_X64
+	// SSE2 is always available on x64, so this doesn't need the `get_simd_level` dispatch
+	constexpr size_t lane_count = 16 / sizeof(wchar_t);
+	const __m128i broadcast = sizeof(wchar_t) == 2 ? _mm_set1_epi16((short)c) : _mm_set1_epi32((int)c);
+
+	for (; i + lane_count <= string.length(); i += lane_count) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(string.data() + i));
+		__m128i matches = sizeof(wchar_t) == 2 ? _mm_cmpeq_epi16(block, broadcast) : _mm_cmpeq_epi32(block, broadcast);
+
+		uint32_t bytes = (uint32_t)_mm_movemask_epi8(matches);
+		if (bytes != 0) {
+			return i + (size_t)__builtin_ctz(bytes) / sizeof(wchar_t);
+		}
+	}
+#endif
+
+	for (; i < string.length(); i++) {
+		if (string[i] == c) {
+			return i;
+		}
+	}
+
+	return string.length();
+}
+
+// Greedy forward match of a single pattern, unrolled over the pattern characters.
+//
+// The 1 and 2 character patterns are often far apart in the name or not in it at all,
+// so they are searched for with the SIMD `find_char`, longer patterns tend to match within a few characters.
+template<size_t N>
+static bool find_short_forward_match(std::wstring_view string, const wchar_t (&chars)[N], uint32_t* positions) {
+	size_t i = 0;
+	for (size_t k = 0; k < N; k++) {
+		if constexpr (N <= 2) {
+			i = find_char(string, i, chars[k]);
+		} else {
+			while (i < string.length() && string[i] != chars[k]) {
+				i += 1;
+			}
+		}
+
+		if (i == string.length()) {
+			return false;
+		}
+
+		positions[k] = (uint32_t)i;
+		i += 1;
+	}
+
+	return true;
+}
+
+// Same alignment as `compute_alignment`, but the matrix is filled column by column,
+// so that only the two previous columns are needed and they stay in registers.
+// The origins are only stored when the positions are written.
+template<size_t N>
+static int32_t compute_short_alignment(std::wstring_view string,
+		const uint8_t* char_bonuses,
+		const wchar_t (&chars)[N],
+		size_t window_start,
+		size_t window_length,
+		const ScoringScratch& scratch,
+		uint32_t* out_positions,
+		bool write_positions) {
+	const wchar_t* window = string.data() + window_start;
+	const uint8_t* window_bonuses = char_bonuses + window_start;
+
+	int32_t previous_column[N];
+	int32_t before_previous_column[N];
+	int32_t gap_scores[N];
+	uint16_t gap_origins[N];
+	for (size_t i = 0; i < N; i++) {
+		previous_column[i] = SCORE_NONE;
+		before_previous_column[i] = SCORE_NONE;
+		gap_scores[i] = SCORE_NONE;
+		gap_origins[i] = NO_ORIGIN;
+	}
+
+	size_t best_column = 0;
+	int32_t best_score = SCORE_NONE;
+	for (size_t j = 0; j < window_length; j++) {
+		wchar_t c = window[j];
+		int32_t bonus = (int32_t)window_bonuses[j];
+
+		int32_t column[N];
+		for (size_t i = 0; i < N; i++) {
+			if (i > 0 && j >= 2) {
+				gap_scores[i] += SCORE_GAP_EXTENSION;
+
+				int32_t gap_start_score = before_previous_column[i - 1] + SCORE_GAP_START;
+				if (gap_start_score > gap_scores[i]) {
+					gap_scores[i] = gap_start_score;
+					gap_origins[i] = (uint16_t)(j - 2);
+				}
+			}
+
+			column[i] = SCORE_NONE;
+			if (c != chars[i]) {
+				continue;
+			}
+
+			if (i == 0) {
+				column[i] = SCORE_MATCH + bonus * BONUS_FIRST_CHAR_MULTIPLIER;
+				continue;
+			}
+
+			int32_t match_score = SCORE_NONE;
+			uint16_t origin = NO_ORIGIN;
+
+			// Consecutive matches win the ties, so that highlights are not fragmented
+			if (previous_column[i - 1] > SCORE_NONE) {
+				match_score = previous_column[i - 1] + BONUS_CONSECUTIVE;
+				origin = (uint16_t)(j - 1);
+			}
+
+			if (gap_scores[i] > match_score && gap_scores[i] > SCORE_NONE / 2) {
+				match_score = gap_scores[i];
+				origin = gap_origins[i];
+			}
+
+			if (origin == NO_ORIGIN) {
+				continue;
+			}
+
+			column[i] = match_score + SCORE_MATCH + bonus;
+			if (write_positions) {
+				scratch.alignment_origins[i * window_length + j] = origin;
+			}
+		}
+
+		if (column[N - 1] > best_score) {
+			best_score = column[N - 1];
+			best_column = j;
+		}
+
+		for (size_t i = 0; i < N; i++) {
+			before_previous_column[i] = previous_column[i];
+			previous_column[i] = column[i];
+		}
+	}
+
+	assert(best_score > SCORE_NONE);
+
+	if (!write_positions) {
+		return best_score;
+	}
+
+	size_t column = best_column;
+	for (size_t i = N; i > 0; i--) {
+		out_positions[i - 1] = (uint32_t)(window_start + column);
+		column = scratch.alignment_origins[(i - 1) * window_length + column];
+	}
+
+	return best_score;
+}
+
+// Same as `find_forward_matches` followed by `score_forward_match` for a single pattern.
+//
+// Returns whether the `string` contains the pattern.
+template<size_t N>
+static bool score_short_pattern(std::wstring_view string,
+		const uint8_t* char_bonuses,
+		const wchar_t (&chars)[N],
+		uint32_t* positions,
+		const ScoringScratch& scratch,
+		bool write_positions,
+		uint32_t* out_score) {
+	int32_t score = 0;
+	if constexpr (N == 1) {
+		// The best alignment of a single character is its occurrence with the highest bonus
+		size_t first = find_char(string, 0, chars[0]);
+		if (first == string.length()) {
+			return false;
+		}
+
+		size_t best = first;
+		size_t last = first;
+		for (size_t i = find_char(string, first + 1, chars[0]); i < string.length(); i = find_char(string, i + 1, chars[0])) {
+			if (char_bonuses[i] > char_bonuses[best]) {
+				best = i;
+			}
+
+			last = i;
+		}
+
+		// NOTE: Matches `score_forward_match`, which falls back to the forward match for the windows that are too long
+		if (last - first + 1 > MAX_ALIGNMENT_WINDOW_LENGTH) {
+			best = first;
+		}
+
+		positions[0] = (uint32_t)best;
+		score = SCORE_MATCH + (int32_t)char_bonuses[best] * BONUS_FIRST_CHAR_MULTIPLIER;
+	} else {
+		if (!find_short_forward_match<N>(string, chars, positions)) {
+			return false;
+		}
+
+		size_t window_start = positions[0];
+		size_t window_end = string.length();
+		while (string[window_end - 1] != chars[N - 1]) {
+			window_end -= 1;
+		}
+
+		size_t window_length = window_end - window_start;
+		if (window_length <= MAX_ALIGNMENT_WINDOW_LENGTH) {
+			score = compute_short_alignment<N>(string, char_bonuses, chars, window_start, window_length, scratch, positions, write_positions);
+		} else {
+			score = score_match_positions(char_bonuses, positions, N);
+		}
+	}
+
+	*out_score = score > 0 ? (uint32_t)score : 1;
+	return true;
+}
+
+// `compute_search_score` for the patterns of length `N`, gives the same scores and highlights.
+template<size_t N>
+static SearchScore compute_short_search_score(std::wstring_view string,
+		const uint8_t* char_bonuses,
+		std::wstring_view pattern,
+		std::wstring_view lang_agnostic_pattern,
+		const ScoringScratch& scratch,
+		RangeU32* out_ranges) {
+	static_assert(N >= 1 && N <= MAX_SHORT_PATTERN_LENGTH);
+	assert(pattern.length() == N && lang_agnostic_pattern.length() == N);
+
+	wchar_t chars[N];
+	wchar_t lang_agnostic_chars[N];
+	for (size_t i = 0; i < N; i++) {
+		chars[i] = pattern[i];
+		lang_agnostic_chars[i] = lang_agnostic_pattern[i];
+	}
+
+	bool write_positions = out_ranges != nullptr;
+
+	uint32_t* positions = scratch.positions;
+	uint32_t* lang_agnostic_positions = scratch.positions + N;
+
+	uint32_t score = 0;
+	bool is_match = score_short_pattern<N>(string, char_bonuses, chars, positions, scratch, write_positions, &score);
+
+	const uint32_t* best_positions = positions;
+	if (pattern != lang_agnostic_pattern) {
+		uint32_t lang_agnostic_score = 0;
+		bool is_lang_agnostic_match = score_short_pattern<N>(string,
+				char_bonuses,
+				lang_agnostic_chars,
+				lang_agnostic_positions,
+				scratch,
+				write_positions,
+				&lang_agnostic_score);
+
+		if (is_lang_agnostic_match && (!is_match || score < lang_agnostic_score)) {
+			score = lang_agnostic_score;
+			best_positions = lang_agnostic_positions;
+		}
+
+		is_match = is_match || is_lang_agnostic_match;
+	}
+
+	if (!is_match) {
+		return SearchScore { .value = 0, .highlight_range_count = 0, .is_full_match = false };
+	}
+
+	uint32_t highlight_count = 0;
+	if (out_ranges != nullptr) {
+		highlight_count = write_highlight_ranges(best_positions, N, out_ranges);
+	}
+
+	return SearchScore {
+		.value = score,
+		.highlight_range_count = highlight_count,
+		.is_full_match = true,
+	};
+}
+
+// Scores the `string` against both patterns and returns the better of the scores.
+// The patterns are matched in a single pass over the `string`, and only once when they are equal,
+// which is the common case for the layouts that type latin characters.
+//
+// The `string` and the patterns are expected to be folded.
+//
+// `out_ranges` is optional, when provided receives the highlights of the better match.
+// It must have space for `max(pattern.length(), lang_agnostic_pattern.length())` ranges,
+// because every range contains at least one matched pattern character.
+static SearchScore compute_generic_search_score(std::wstring_view string,
+		const uint8_t* char_bonuses,
+		std::wstring_view pattern,
+		std::wstring_view lang_agnostic_pattern,
+		const ScoringScratch& scratch,
+		RangeU32* out_ranges) {
+	bool are_patterns_equal = pattern == lang_agnostic_pattern;
+	if (are_patterns_equal) {
+		lang_agnostic_pattern = {};
+	}
+
+	uint32_t* positions = scratch.positions;
+	uint32_t* lang_agnostic_positions = scratch.positions + pattern.length();
+
+	size_t match_count = 0;
+	size_t lang_agnostic_match_count = 0;
+	find_forward_matches(string,
+			pattern,
+			lang_agnostic_pattern,
+			positions,
+			lang_agnostic_positions,
+			&match_count,
+			&lang_agnostic_match_count);
+
+	bool is_match = match_count == pattern.length();
+	bool is_lang_agnostic_match = !are_patterns_equal && lang_agnostic_match_count == lang_agnostic_pattern.length();
+
+	if (!is_match && !is_lang_agnostic_match) {
+		return SearchScore { .value = 0, .highlight_range_count = 0, .is_full_match = false };
+	}
+
+	bool write_positions = out_ranges != nullptr;
+
+	uint32_t score = 0;
+	if (is_match) {
+		score = score_forward_match(string, char_bonuses, pattern, positions, scratch, write_positions);
+	}
+
+	const uint32_t* best_positions = positions;
+	size_t best_position_count = pattern.length();
+
+	if (is_lang_agnostic_match) {
+		uint32_t lang_agnostic_score = score_forward_match(string,
+				char_bonuses,
+				lang_agnostic_pattern,
+				lang_agnostic_positions,
+				scratch,
+				write_positions);
+
+		if (!is_match || score < lang_agnostic_score) {
+			score = lang_agnostic_score;
+			best_positions = lang_agnostic_positions;
+			best_position_count = lang_agnostic_pattern.length();
+		}
+	}
+
+	uint32_t highlight_count = 0;
+	if (out_ranges != nullptr) {
+		highlight_count = write_highlight_ranges(best_positions, best_position_count, out_ranges);
+	}
+
+	return SearchScore {
+		.value = score,
+		.highlight_range_count = highlight_count,
+		.is_full_match = true,
+	};
+}
+
+// Scores the `string` with the kernel specialized for the pattern length when there is one.
+//
+// See `compute_generic_search_score` for the parameters.
+static SearchScore compute_search_score(std::wstring_view string,
+		const uint8_t* char_bonuses,
+		std::wstring_view pattern,
+		std::wstring_view lang_agnostic_pattern,
+		const ScoringScratch& scratch,
+		RangeU32* out_ranges) {
+	if (pattern.length() == lang_agnostic_pattern.length()) {
+		switch (pattern.length()) {
+		case 1:
+			return compute_short_search_score<1>(string, char_bonuses, pattern, lang_agnostic_pattern, scratch, out_ranges);
+		case 2:
+			return compute_short_search_score<2>(string, char_bonuses, pattern, lang_agnostic_pattern, scratch, out_ranges);
+		case 3:
+			return compute_short_search_score<3>(string, char_bonuses, pattern, lang_agnostic_pattern, scratch, out_ranges);
+		case 4:
+			return compute_short_search_score<4>(string, char_bonuses, pattern, lang_agnostic_pattern, scratch, out_ranges);
+		case 5:
+			return compute_short_search_score<5>(string, char_bonuses, pattern, lang_agnostic_pattern, scratch, out_ranges);
+		case 6:
+			return compute_short_search_score<6>(string, char_bonuses, pattern, lang_agnostic_pattern, scratch, out_ranges);
+		case 7:
+			return compute_short_search_score<7>(string, char_bonuses, pattern, lang_agnostic_pattern, scratch, out_ranges);
+		case 8:
+			return compute_short_search_score<8>(string, char_bonuses, pattern, lang_agnostic_pattern, scratch, out_ranges);
+		}
+	}
+
+	return compute_generic_search_score(string, char_bonuses, pattern, lang_agnostic_pattern, scratch, out_ranges);
+}
+
+// Scores the first field of the entry that contains either of the patterns, the fields are ordered by their weight.
+//
+// Each field is only scanned once and only the matching one is aligned,
+// so the fields don't multiply the scoring time of the entries that don't match them.
+static SearchScore compute_field_search_score(const SearchCorpus& corpus,
+		uint32_t entry_index,
+		std::wstring_view pattern,
+		std::wstring_view lang_agnostic_pattern,
+		const ScoringScratch& scratch) {
+	std::wstring_view record = search_corpus_get_record(corpus, entry_index);
+	const uint8_t* record_bonuses = search_corpus_get_char_bonuses(corpus, entry_index);
+
+	uint32_t field_start = corpus.name_lengths[entry_index];
+	for (uint32_t slot = 0; slot < corpus.field_count; slot++) {
+		uint32_t field_length = corpus.field_lengths[slot][entry_index];
+		if (field_length == 0) {
+			continue;
+		}
+
+		std::wstring_view field = record.substr(field_start, field_length);
+		SearchScore score = compute_search_score(field, record_bonuses + field_start, pattern, lang_agnostic_pattern, scratch, nullptr);
+		if (score.is_full_match) {
+			uint32_t weighted_score = (uint32_t)((float)score.value * corpus.field_weights[slot]);
+
+			// Keep the field matches above the entries that didn't match
+			score.value = max(weighted_score, 1u);
+			return score;
+		}
+
+		field_start += field_length;
+	}
+
+	return SearchScore { .value = 0, .highlight_range_count = 0, .is_full_match = false };
+}
+
+// Bonus for a `pattern` that is a run of consecutive `initials`, for example `vsc` for `Microsoft Visual Studio Code`
+static uint32_t compute_acronym_bonus(std::wstring_view initials, std::wstring_view pattern) {
+	if (pattern.length() < MIN_ACRONYM_LENGTH) {
+		return 0;
+	}
+
+	size_t position = initials.find(pattern);
+	if (position == std::wstring_view::npos) {
+		return 0;
+	}
+
+	uint32_t bonus = (uint32_t)(BONUS_ACRONYM * pattern.length());
+	return position == 0 ? 2 * bonus : bonus;
+}
+
+struct ScoringChunk {
+	const SearchCorpus* corpus;
+	const std::vector<Entry>* entries;
+	const SearchState* state;
+
+	std::wstring_view pattern;
+	std::wstring_view lang_agnostic_pattern;
+	QueryPrefixHashes prefix_hashes;
+
+	Span<uint32_t> candidates;
+
+	// Best results are sorted by score, see `sort_top_results`
+	Span<ResultEntry> results;
+
+	bool is_cancelled;
+};
+
+inline static bool is_search_cancelled(const SearchState& state) {
+	return state.latest_generation != nullptr
+		&& state.latest_generation->load(std::memory_order::relaxed) != state.generation;
+}
+
+static float compute_final_score(uint32_t match_score,
+		uint32_t entry_index,
+		const std::vector<Entry>& entries,
+		const SearchState& state,
+		const QueryPrefixHashes& prefix_hashes) {
+	float frecency = state.frecencies != nullptr ? state.frecencies[entry_index] : entries[entry_index].frecency;
+	float score = (float)match_score + frecency * state.frecency_weight;
+
+	if (state.query_history != nullptr) {
+		uint32_t launch_count = 0;
+		for (uint32_t i = 0; i < prefix_hashes.count; i++) {
+			launch_count = max(launch_count, query_history_get_launch_count(*state.query_history, prefix_hashes.values[i], entry_index));
+		}
+
+		score += (float)min(launch_count, MAX_BOOSTED_QUERY_LAUNCH_COUNT) * QUERY_LAUNCH_BONUS;
+	}
+
+	return score;
+}
+
+inline static bool compare_results(const ResultEntry& a, const ResultEntry& b) {
+	return a.score > b.score;
+}
+
+// Moves the best `count` results to the front in sorted order,
+// the rest of the results are left unordered, but none of them is better than the sorted ones.
+static void sort_top_results(ResultEntry* begin, ResultEntry* end, size_t count) {
+	PROFILE_FUNCTION();
+
+	if (count < (size_t)(end - begin)) {
+		std::nth_element(begin, begin + count, end, compare_results);
+		end = begin + count;
+	}
+
+	std::sort(begin, end, compare_results);
+}
+
+// Scores the candidates of the chunk and writes the ones that matched either of the patterns into the chunk's `results`.
+//
+// The highlights are not computed, see `search_result_compute_highlights`.
+static void score_chunk(ScoringChunk& chunk, const ScoringScratch& scratch) {
+	PROFILE_FUNCTION();
+
+	const SearchCorpus& corpus = *chunk.corpus;
+
+	size_t result_count = 0;
+
+	for (size_t i = 0; i < chunk.candidates.count; i++) {
+		if (i % CANCELLATION_CHECK_INTERVAL == 0 && is_search_cancelled(*chunk.state)) {
+			chunk.is_cancelled = true;
+			return;
+		}
+
+		uint32_t entry_index = chunk.candidates[i];
+		std::wstring_view name = search_corpus_get_name(corpus, entry_index);
+		const uint8_t* char_bonuses = search_corpus_get_char_bonuses(corpus, entry_index);
+
+		SearchScore score = compute_search_score(name, char_bonuses, chunk.pattern, chunk.lang_agnostic_pattern, scratch, nullptr);
+		if (score.is_full_match) {
+			// The initials are a subsequence of the name, so only the full matches can match them
+			std::wstring_view initials = search_corpus_get_initials(corpus, entry_index);
+			score.value += max(compute_acronym_bonus(initials, chunk.pattern),
+					compute_acronym_bonus(initials, chunk.lang_agnostic_pattern));
+		} else if (corpus.field_count != 0) {
+			score = compute_field_search_score(corpus, entry_index, chunk.pattern, chunk.lang_agnostic_pattern, scratch);
+		}
+
+		if (!score.is_full_match) {
+			continue;
+		}
+
+		float final_score = compute_final_score(score.value, entry_index, *chunk.entries, *chunk.state, chunk.prefix_hashes);
+
+		chunk.results[result_count] = ResultEntry { entry_index, score.value, final_score, RangeU32 { HIGHLIGHTS_NOT_COMPUTED, 0 } };
+		result_count += 1;
+	}
+
+	chunk.results.count = result_count;
+
+	sort_top_results(chunk.results.begin(), chunk.results.end(), SORTED_RESULT_BATCH_SIZE);
+}
+
+static void score_chunk_task(const JobContext& context, void* user_data) {
+	PROFILE_FUNCTION();
+
+	Span<ScoringChunk> chunks = Span(reinterpret_cast<ScoringChunk*>(user_data), context.batch_size);
+	for (ScoringChunk& chunk : chunks) {
+		ArenaSavePoint temp = arena_begin_temp(context.temp_arena);
+		ScoringScratch scratch = scoring_scratch_alloc(context.temp_arena,
+				chunk.pattern.length() + chunk.lang_agnostic_pattern.length());
+
+		score_chunk(chunk, scratch);
+		arena_end_temp(temp);
+	}
+}
+
+// Merges the best results of all the chunks into the front of the `result`,
+// then appends the rest of the results unordered.
+//
+// Returns the number of sorted results.
+static size_t merge_chunk_results(Span<ScoringChunk> chunks, std::vector<ResultEntry>& result, Arena& arena) {
+	PROFILE_FUNCTION();
+
+	struct ChunkCursor {
+		const ScoringChunk* chunk;
+		size_t read_position;
+		size_t sorted_count;
+	};
+
+	// Min-heap by the score of the next result, so the best result is at the front
+	auto compare_cursors = [](const ChunkCursor& a, const ChunkCursor& b) -> bool {
+		return compare_results(b.chunk->results[b.read_position], a.chunk->results[a.read_position]);
+	};
+
+	size_t total_result_count = 0;
+	for (const ScoringChunk& chunk : chunks) {
+		total_result_count += chunk.results.count;
+	}
+
+	result.reserve(total_result_count);
+
+	ChunkCursor* cursors = arena_alloc_array<ChunkCursor>(arena, chunks.count);
+	for (size_t i = 0; i < chunks.count; i++) {
+		const ScoringChunk& chunk = chunks[i];
+
+		cursors[i] = ChunkCursor {
+			.chunk = &chunk,
+			.read_position = 0,
+			.sorted_count = min(chunk.results.count, SORTED_RESULT_BATCH_SIZE),
+		};
+	}
+
+	auto push_result = [&](const ChunkCursor& cursor, size_t index) {
+		result.push_back(cursor.chunk->results[index]);
+	};
+
+	{
+		// Every chunk has its best results sorted,
+		// so the best results overall are among them.
+		ChunkCursor* heap = arena_alloc_array<ChunkCursor>(arena, chunks.count);
+		size_t heap_size = 0;
+
+		for (size_t i = 0; i < chunks.count; i++) {
+			if (cursors[i].sorted_count != 0) {
+				heap[heap_size] = cursors[i];
+				heap_size += 1;
+			}
+		}
+
+		std::make_heap(heap, heap + heap_size, compare_cursors);
+
+		while (heap_size != 0 && result.size() < SORTED_RESULT_BATCH_SIZE) {
+			std::pop_heap(heap, heap + heap_size, compare_cursors);
+			ChunkCursor& cursor = heap[heap_size - 1];
+
+			push_result(cursor, cursor.read_position);
+
+			cursor.read_position += 1;
+			cursors[cursor.chunk - chunks.values].read_position = cursor.read_position;
+
+			if (cursor.read_position == cursor.sorted_count) {
+				heap_size -= 1;
+			} else {
+				std::push_heap(heap, heap + heap_size, compare_cursors);
+			}
+		}
+	}
+
+	size_t sorted_count = result.size();
+
+	for (size_t i = 0; i < chunks.count; i++) {
+		const ChunkCursor& cursor = cursors[i];
+		for (size_t j = cursor.read_position; j < cursor.chunk->results.count; j++) {
+			push_result(cursor, j);
+		}
+	}
+
+	return sorted_count;
+}
+
+void search_sort_results(SearchResult& result, size_t required_count) {
+	std::vector<ResultEntry>& matches = result.matches;
+
+	required_count = min(required_count, matches.size());
+	if (required_count <= result.sorted_count) {
+		return;
+	}
+
+	PROFILE_FUNCTION();
+
+	// Sort a whole batch at once, so that scrolling doesn't sort on every step
+	size_t new_sorted_count = max(required_count, result.sorted_count + SORTED_RESULT_BATCH_SIZE);
+	sort_top_results(matches.data() + result.sorted_count,
+			matches.data() + matches.size(),
+			new_sorted_count - result.sorted_count);
+
+	result.sorted_count = min(new_sorted_count, matches.size());
+}
+
+void search_result_compute_highlights(SearchResult& result, size_t result_index, const SearchCorpus& corpus, Arena& temp_arena) {
+	ResultEntry& entry_result = result.matches[result_index];
+	if (entry_result.highlights.start != HIGHLIGHTS_NOT_COMPUTED) {
+		return;
+	}
+
+	PROFILE_FUNCTION();
+
+	ArenaSavePoint temp = arena_begin_temp(temp_arena);
+
+	size_t max_pattern_length = max(result.pattern.length(), result.lang_agnostic_pattern.length());
+	ScoringScratch scratch = scoring_scratch_alloc(temp_arena, result.pattern.length() + result.lang_agnostic_pattern.length());
+	RangeU32* ranges = arena_alloc_array<RangeU32>(temp_arena, max_pattern_length);
+
+	std::wstring_view name = search_corpus_get_name(corpus, entry_result.entry_index);
+	const uint8_t* char_bonuses = search_corpus_get_char_bonuses(corpus, entry_result.entry_index);
+
+	SearchScore score = compute_search_score(name, char_bonuses, result.pattern, result.lang_agnostic_pattern, scratch, ranges);
+
+	entry_result.highlights = RangeU32 { (uint32_t)result.highlights.size(), score.highlight_range_count };
+	result.highlights.insert(result.highlights.end(), ranges, ranges + score.highlight_range_count);
+
+	arena_end_temp(temp);
+}
+
+//
+// Empty Query
+//
+
+inline static bool compare_ranked_entries(const ResultEntry& a, const ResultEntry& b) {
+	// Ties are ordered by the entry index, so that the order doesn't depend on the order of the reranks
+	return a.score > b.score || (a.score == b.score && a.entry_index < b.entry_index);
+}
+
+// The empty pattern matches every name with a zero score and without any highlights
+inline static ResultEntry make_ranked_entry(const std::vector<Entry>& entries, const SearchState& state, uint32_t entry_index) {
+	float score = compute_final_score(0, entry_index, entries, state, QueryPrefixHashes{});
+	return ResultEntry { entry_index, 0, score, RangeU32 { 0, 0 } };
+}
+
+static void rank_all_entries(SearchState& state, const std::vector<Entry>& entries) {
+	PROFILE_FUNCTION();
+
+	state.ranked_entries.resize(entries.size());
+	state.entry_ranks.resize(entries.size());
+
+	for (uint32_t i = 0; i < (uint32_t)entries.size(); i++) {
+		state.ranked_entries[i] = make_ranked_entry(entries, state, i);
+	}
+
+	std::sort(state.ranked_entries.begin(), state.ranked_entries.end(), compare_ranked_entries);
+
+	for (uint32_t i = 0; i < (uint32_t)entries.size(); i++) {
+		state.entry_ranks[state.ranked_entries[i].entry_index] = i;
+	}
+
+	state.are_ranks_valid = true;
+}
+
+void search_state_rerank_entry(SearchState& state, const std::vector<Entry>& entries, uint32_t entry_index) {
+	if (!state.are_ranks_valid) {
+		return;
+	}
+
+	if (state.ranked_entries.size() != entries.size()) {
+		state.are_ranks_valid = false;
+		return;
+	}
+
+	PROFILE_FUNCTION();
+
+	ResultEntry* ranked_entries = state.ranked_entries.data();
+	uint32_t* entry_ranks = state.entry_ranks.data();
+	uint32_t rank_count = (uint32_t)state.ranked_entries.size();
+
+	ResultEntry reranked = make_ranked_entry(entries, state, entry_index);
+	uint32_t rank = entry_ranks[entry_index];
+
+	// Shift the entries between the old and the new rank by one, in whichever direction the entry moves
+	while (rank > 0 && compare_ranked_entries(reranked, ranked_entries[rank - 1])) {
+		ranked_entries[rank] = ranked_entries[rank - 1];
+		entry_ranks[ranked_entries[rank].entry_index] = rank;
+		rank -= 1;
+	}
+
+	while (rank + 1 < rank_count && compare_ranked_entries(ranked_entries[rank + 1], reranked)) {
+		ranked_entries[rank] = ranked_entries[rank + 1];
+		entry_ranks[ranked_entries[rank].entry_index] = rank;
+		rank += 1;
+	}
+
+	ranked_entries[rank] = reranked;
+	entry_ranks[entry_index] = rank;
+}
+
+void search_state_invalidate_ranks(SearchState& state) {
+	state.are_ranks_valid = false;
+}
+
+//
+// Result Cache
+//
+
+static constexpr size_t SEARCH_CACHE_ARENA_CAPACITY = mb_to_bytes(16);
+
+// Results larger than this are not cached, so that a single result can't evict the whole cache
+static constexpr size_t MAX_CACHED_RESULT_SIZE = SEARCH_CACHE_ARENA_CAPACITY / 4;
+
+static uint64_t hash_search_patterns(std::wstring_view pattern, std::wstring_view lang_agnostic_pattern) {
+	uint64_t hash = FNV_OFFSET_BASIS;
+	auto hash_string = [&hash](std::wstring_view string) {
+		for (wchar_t c : string) {
+			hash = hash_pattern_char(hash, c);
+		}
+
+		hash = hash_pattern_char(hash, (wchar_t)0xffff);
+	};
+
+	hash_string(pattern);
+	hash_string(lang_agnostic_pattern);
+	return hash;
+}
+
+inline static size_t get_cache_entry_size(std::wstring_view pattern, std::wstring_view lang_agnostic_pattern, size_t match_count) {
+	// + alignment of the matches after the patterns
+	return sizeof(wchar_t) * (pattern.length() + lang_agnostic_pattern.length())
+		+ sizeof(ResultEntry) * match_count
+		+ alignof(ResultEntry);
+}
+
+static void search_cache_clear(SearchCache& cache) {
+	arena_reset(cache.arenas[0]);
+	arena_reset(cache.arenas[1]);
+
+	cache.entry_count = 0;
+	cache.entries_size = 0;
+}
+
+static void search_cache_release(SearchCache& cache) {
+	search_cache_clear(cache);
+
+	arena_release(cache.arenas[0]);
+	arena_release(cache.arenas[1]);
+}
+
+static SearchCacheEntry* search_cache_find(SearchCache& cache,
+		uint64_t hash,
+		std::wstring_view pattern,
+		std::wstring_view lang_agnostic_pattern) {
+	for (uint32_t i = 0; i < cache.entry_count; i++) {
+		SearchCacheEntry& entry = cache.entries[i];
+		if (entry.hash == hash && entry.pattern == pattern && entry.lang_agnostic_pattern == lang_agnostic_pattern) {
+			return &entry;
+		}
+	}
+
+	return nullptr;
+}
+
+static void search_cache_evict_least_recently_used(SearchCache& cache) {
+	assert(cache.entry_count != 0);
+
+	uint32_t evicted_index = 0;
+	for (uint32_t i = 1; i < cache.entry_count; i++) {
+		if (cache.entries[i].last_use < cache.entries[evicted_index].last_use) {
+			evicted_index = i;
+		}
+	}
+
+	const SearchCacheEntry& evicted = cache.entries[evicted_index];
+	cache.entries_size -= get_cache_entry_size(evicted.pattern, evicted.lang_agnostic_pattern, evicted.matches.count);
+
+	cache.entries[evicted_index] = cache.entries[cache.entry_count - 1];
+	cache.entry_count -= 1;
+}
+
+static void copy_cache_entry_data(SearchCacheEntry& entry,
+		std::wstring_view pattern,
+		std::wstring_view lang_agnostic_pattern,
+		const ResultEntry* matches,
+		size_t match_count,
+		Arena& arena) {
+	entry.pattern = arena_push_string(arena, pattern);
+	entry.lang_agnostic_pattern = arena_push_string(arena, lang_agnostic_pattern);
+
+	entry.matches = arena_alloc_span<ResultEntry>(arena, match_count);
+	std::memcpy(entry.matches.values, matches, sizeof(ResultEntry) * match_count);
+}
+
+static void search_cache_insert(SearchCache& cache,
+		uint64_t hash,
+		std::wstring_view pattern,
+		std::wstring_view lang_agnostic_pattern,
+		const std::vector<ResultEntry>& matches) {
+	PROFILE_FUNCTION();
+
+	size_t entry_size = get_cache_entry_size(pattern, lang_agnostic_pattern, matches.size());
+	if (entry_size > MAX_CACHED_RESULT_SIZE) {
+		return;
+	}
+
+	while (cache.entry_count == SEARCH_CACHE_CAPACITY || cache.entries_size + entry_size > SEARCH_CACHE_ARENA_CAPACITY) {
+		search_cache_evict_least_recently_used(cache);
+	}
+
+	for (Arena& arena : cache.arenas) {
+		if (arena.capacity == 0) {
+			arena.capacity = SEARCH_CACHE_ARENA_CAPACITY;
+		}
+	}
+
+	if (cache.arenas[cache.active_arena].allocated + entry_size > SEARCH_CACHE_ARENA_CAPACITY) {
+		PROFILE_SCOPE("compact_search_cache");
+
+		// The evicted entries still take space in the active arena,
+		// move the remaining ones to the other arena, which then becomes the active one
+		uint32_t compacted_arena_index = 1 - cache.active_arena;
+		Arena& compacted_arena = cache.arenas[compacted_arena_index];
+		arena_reset(compacted_arena);
+
+		for (uint32_t i = 0; i < cache.entry_count; i++) {
+			SearchCacheEntry& entry = cache.entries[i];
+			copy_cache_entry_data(entry,
+					entry.pattern,
+					entry.lang_agnostic_pattern,
+					entry.matches.values,
+					entry.matches.count,
+					compacted_arena);
+		}
+
+		arena_reset(cache.arenas[cache.active_arena]);
+		cache.active_arena = compacted_arena_index;
+	}
+
+	SearchCacheEntry& entry = cache.entries[cache.entry_count];
+	cache.entry_count += 1;
+
+	entry.hash = hash;
+	entry.last_use = ++cache.use_counter;
+	copy_cache_entry_data(entry, pattern, lang_agnostic_pattern, matches.data(), matches.size(), cache.arenas[cache.active_arena]);
+
+	cache.entries_size += entry_size;
+}
+
+// Returns `true` if the new query can be computed by only rescanning the entries
+// that fully matched the previous query.
+//
+// Only entries containing the whole pattern end up in the result,
+// and appending characters to a pattern can only shrink that set.
+static bool is_search_refinement(const SearchState& state,
+		std::wstring_view search_pattern,
+		std::wstring_view lang_agnostic_search_pattern,
+		size_t entry_count) {
+	if (!state.is_valid || state.entry_count != entry_count) {
+		return false;
+	}
+
+	return search_pattern.length() > state.pattern.length()
+		&& search_pattern.starts_with(state.pattern)
+		&& lang_agnostic_search_pattern.starts_with(state.lang_agnostic_pattern);
+}
+
+void search_state_release(SearchState& state) {
+	arena_release(state.scratch_arena);
+	search_cache_release(state.cache);
+
+	state.is_valid = false;
+	state.full_match_candidates.clear();
+
+	state.are_ranks_valid = false;
+}
+
+// Stores the patterns of the query in the `result` and remembers the query for the refinement of the next one
+static void finish_search_result(std::wstring_view folded_pattern,
+		std::wstring_view folded_lang_agnostic_pattern,
+		const std::vector<Entry>& entries,
+		SearchState& search_state,
+		SearchResult& result) {
+	result.pattern.reserve(RESERVED_PATTERN_LENGTH);
+	result.lang_agnostic_pattern.reserve(RESERVED_PATTERN_LENGTH);
+	result.highlights.reserve(RESERVED_HIGHLIGHT_COUNT);
+	result.pattern = folded_pattern;
+	result.lang_agnostic_pattern = folded_lang_agnostic_pattern;
+
+	search_state.full_match_candidates.clear();
+	search_state.full_match_candidates.reserve(entries.size());
+	for (const ResultEntry& entry_result : result.matches) {
+		search_state.full_match_candidates.push_back(entry_result.entry_index);
+	}
+
+	search_state.is_valid = true;
+	search_state.entry_count = entries.size();
+	search_state.pattern = folded_pattern;
+	search_state.lang_agnostic_pattern = folded_lang_agnostic_pattern;
+}
+
+bool update_search_result(std::wstring_view search_pattern,
+		std::wstring_view lang_agnostic_search_pattern,
+		const std::vector<Entry>& entries,
+		const SearchCorpus& corpus,
+		SearchState& search_state,
+		SearchResult& result,
+		Arena& arena) {
+	PROFILE_FUNCTION();
+
+	assert(corpus.entry_count == entries.size());
+
+	// Every entry matches the empty query, so its result is maintained rather than scored
+	if (search_pattern.empty() && lang_agnostic_search_pattern.empty()) {
+		PROFILE_SCOPE("empty_query");
+
+		if (!search_state.are_ranks_valid || search_state.ranked_entries.size() != entries.size()) {
+			rank_all_entries(search_state, entries);
+		}
+
+		result.matches.reserve(entries.size());
+		result.matches.assign(search_state.ranked_entries.begin(), search_state.ranked_entries.end());
+		result.highlights.clear();
+		result.sorted_count = result.matches.size();
+
+		result.pattern.clear();
+		result.lang_agnostic_pattern.clear();
+
+		// Refining the empty query would rescan every entry, which the prefilter does faster
+		search_state.is_valid = false;
+		return true;
+	}
+
+	ArenaSavePoint temp = arena_begin_temp(arena);
+
+	if (search_state.scratch_arena.capacity == 0) {
+		search_state.scratch_arena.capacity = mb_to_bytes(256);
+	}
+
+	Arena& scratch_arena = search_state.scratch_arena;
+	arena_reset(scratch_arena);
+
+	std::wstring_view folded_pattern;
+	std::wstring_view folded_lang_agnostic_pattern;
+
+	{
+		wchar_t* buffer = arena_alloc_array<wchar_t>(arena, search_pattern.length());
+		search_fold_string(search_pattern, buffer);
+		folded_pattern = std::wstring_view(buffer, search_pattern.length());
+
+		buffer = arena_alloc_array<wchar_t>(arena, lang_agnostic_search_pattern.length());
+		search_fold_string(lang_agnostic_search_pattern, buffer);
+		folded_lang_agnostic_pattern = std::wstring_view(buffer, lang_agnostic_search_pattern.length());
+	}
+
+	SearchCache& cache = search_state.cache;
+	if (cache.corpus_entry_count != entries.size()) {
+		search_cache_clear(cache);
+		cache.corpus_entry_count = entries.size();
+	}
+
+	uint64_t pattern_hash = hash_search_patterns(folded_pattern, folded_lang_agnostic_pattern);
+	QueryPrefixHashes prefix_hashes = compute_query_prefix_hashes(folded_pattern, folded_lang_agnostic_pattern);
+	if (SearchCacheEntry* cache_entry = search_cache_find(cache, pattern_hash, folded_pattern, folded_lang_agnostic_pattern)) {
+		PROFILE_SCOPE("cached_result");
+
+		cache_entry->last_use = ++cache.use_counter;
+
+		result.matches.clear();
+		result.matches.reserve(entries.size());
+		result.highlights.clear();
+
+		// The frecency and the query history of the entries could have changed since the result was cached
+		for (const ResultEntry& cached_match : cache_entry->matches) {
+			float score = compute_final_score(cached_match.match_score,
+					cached_match.entry_index,
+					entries,
+					search_state,
+					prefix_hashes);
+
+			result.matches.push_back(ResultEntry {
+				cached_match.entry_index,
+				cached_match.match_score,
+				score,
+				RangeU32 { HIGHLIGHTS_NOT_COMPUTED, 0 }
+			});
+		}
+
+		sort_top_results(result.matches.data(), result.matches.data() + result.matches.size(), SORTED_RESULT_BATCH_SIZE);
+		result.sorted_count = min(result.matches.size(), SORTED_RESULT_BATCH_SIZE);
+
+		finish_search_result(folded_pattern, folded_lang_agnostic_pattern, entries, search_state, result);
+
+		arena_end_temp(temp);
+		return true;
+	}
+
+	uint32_t pattern_mask = search_compute_char_mask(folded_pattern);
+	uint32_t lang_agnostic_pattern_mask = search_compute_char_mask(folded_lang_agnostic_pattern);
+
+	Span<uint32_t> candidates{};
+	if (is_search_refinement(search_state, folded_pattern, folded_lang_agnostic_pattern, entries.size())) {
+		PROFILE_SCOPE("refine_candidates");
+
+		candidates = arena_alloc_span<uint32_t>(scratch_arena, search_state.full_match_candidates.size());
+
+		uint32_t candidate_count = 0;
+		for (uint32_t entry_index : search_state.full_match_candidates) {
+			uint32_t mask = corpus.char_masks[entry_index];
+
+			candidates[candidate_count] = entry_index;
+			candidate_count += char_mask_contains(mask, pattern_mask)
+				|| char_mask_contains(mask, lang_agnostic_pattern_mask);
+		}
+
+		candidates.count = candidate_count;
+	} else {
+		candidates = arena_alloc_span<uint32_t>(scratch_arena, corpus.entry_count);
+
+		uint32_t candidate_count = 0;
+		if (!search_index_query(corpus, folded_pattern, folded_lang_agnostic_pattern, candidates.values, &candidate_count, scratch_arena)) {
+			candidate_count = search_prefilter(corpus, pattern_mask, lang_agnostic_pattern_mask, candidates.values);
+		}
+
+		candidates.count = candidate_count;
+	}
+
+	// Split the candidates into chunks, which are scored on the workers when there are enough of them
+	uint32_t chunk_count = 1;
+	if (candidates.count >= search_state.parallel_search_threshold && job_system_get_worker_count() != 0) {
+		// +1 for the main thread, which also executes the tasks while waiting
+		uint32_t max_chunk_count = job_system_get_worker_count() + 1;
+		chunk_count = (uint32_t)min((candidates.count + MIN_SCORING_CHUNK_SIZE - 1) / MIN_SCORING_CHUNK_SIZE, (size_t)max_chunk_count);
+	}
+
+	size_t chunk_size = (candidates.count + chunk_count - 1) / chunk_count;
+
+	Span<ScoringChunk> chunks = arena_alloc_span<ScoringChunk>(scratch_arena, chunk_count);
+	for (uint32_t i = 0; i < chunk_count; i++) {
+		size_t chunk_start = min(i * chunk_size, candidates.count);
+		size_t chunk_length = min(chunk_size, candidates.count - chunk_start);
+
+		ScoringChunk& chunk = chunks[i];
+		chunk.corpus = &corpus;
+		chunk.entries = &entries;
+		chunk.state = &search_state;
+		chunk.is_cancelled = false;
+		chunk.pattern = folded_pattern;
+		chunk.lang_agnostic_pattern = folded_lang_agnostic_pattern;
+		chunk.prefix_hashes = prefix_hashes;
+		chunk.candidates = candidates.slice(chunk_start, chunk_length);
+		chunk.results = arena_alloc_span<ResultEntry>(scratch_arena, chunk_length);
+	}
+
+	if (chunk_count == 1) {
+		ScoringScratch scratch = scoring_scratch_alloc(arena, folded_pattern.length() + folded_lang_agnostic_pattern.length());
+		score_chunk(chunks[0], scratch);
+	} else {
+		PROFILE_SCOPE("parallel_scoring");
+
+		// NOTE: The chunk buffers are allocated here rather than from the `JobContext::arena`,
+		//       because worker arenas are never reset and would grow with every query.
+		JobGroup job_group{};
+		job_system_submit_batches(&job_group, score_chunk_task, chunks, 1);
+		job_system_wait_for_group(job_group, arena, scratch_arena);
+	}
+
+	for (const ScoringChunk& chunk : chunks) {
+		if (chunk.is_cancelled) {
+			arena_end_temp(temp);
+			return false;
+		}
+	}
+
+	// NOTE: The buffers are sized for every entry matching, so that they only grow
+	//       on the first query rather than reallocating as the number of matches changes.
+	result.matches.clear();
+	result.matches.reserve(entries.size());
+	result.highlights.clear();
+
+	result.sorted_count = merge_chunk_results(chunks, result.matches, arena);
+
+	search_cache_insert(cache, pattern_hash, folded_pattern, folded_lang_agnostic_pattern, result.matches);
+
+	finish_search_result(folded_pattern, folded_lang_agnostic_pattern, entries, search_state, result);
+
+	arena_end_temp(temp);
+	return true;
+}
+
+//
+// Async Search
+//
+
+static void async_search_thread_worker(AsyncSearch* search) {
+	{
+		log_init_thread(search->arena, "search");
+		PROFILE_NAME_THREAD("search");
+	}
+
+	log_info(L"search thread started");
+
+	std::wstring pattern;
+	std::wstring lang_agnostic_pattern;
+	pattern.reserve(RESERVED_PATTERN_LENGTH);
+	lang_agnostic_pattern.reserve(RESERVED_PATTERN_LENGTH);
+
+	std::vector<EntryFrecencyUpdate> frecency_updates;
+
+	while (true) {
+		{
+			std::unique_lock lock(search->mutex);
+			search->wake_var.wait(lock, [search]() { return !search->is_running || search->has_pending_query; });
+
+			if (!search->is_running) {
+				break;
+			}
+
+			// Only the latest posted query is executed, the ones posted before it are skipped
+			pattern = search->pending_pattern;
+			lang_agnostic_pattern = search->pending_lang_agnostic_pattern;
+			search->state.generation = search->latest_generation.load(std::memory_order::relaxed);
+			search->has_pending_query = false;
+
+			if (search->has_pending_frecencies) {
+				std::swap(search->frecencies, search->pending_frecencies);
+				search->state.frecencies = search->frecencies.data();
+				search_state_invalidate_ranks(search->state);
+				search->has_pending_frecencies = false;
+			}
+
+			if (search->has_pending_query_history) {
+				search->query_history = search->pending_query_history;
+				search->has_pending_query_history = false;
+			}
+
+			std::swap(frecency_updates, search->pending_frecency_updates);
+		}
+
+		for (const EntryFrecencyUpdate& update : frecency_updates) {
+			search->frecencies[update.entry_index] = update.frecency;
+			search_state_rerank_entry(search->state, *search->entries, update.entry_index);
+		}
+
+		frecency_updates.clear();
+
+		bool is_completed = false;
+
+		{
+			ArenaSavePoint temp = arena_begin_temp(search->arena);
+			is_completed = update_search_result(pattern,
+					lang_agnostic_pattern,
+					*search->entries,
+					*search->corpus,
+					search->state,
+					search->working_result,
+					search->arena);
+
+			arena_end_temp(temp);
+		}
+
+		if (!is_completed) {
+			continue;
+		}
+
+		{
+			std::unique_lock lock(search->mutex);
+			std::swap(search->completed_result, search->working_result);
+			search->has_completed_result = true;
+		}
+
+		search->result_ready_callback(search->callback_user_data);
+	}
+
+	log_info(L"search thread stopped");
+	log_shutdown_thread();
+}
+
+void async_search_start(AsyncSearch& search,
+		const std::vector<Entry>& entries,
+		const SearchCorpus& corpus,
+		const QueryHistory* query_history,
+		uint32_t parallel_search_threshold,
+		float frecency_weight,
+		SearchResultReadyCallback result_ready_callback,
+		void* callback_user_data) {
+	PROFILE_FUNCTION();
+
+	search.entries = &entries;
+	search.corpus = &corpus;
+	search.result_ready_callback = result_ready_callback;
+	search.callback_user_data = callback_user_data;
+
+	search.state.parallel_search_threshold = parallel_search_threshold;
+	search.state.frecency_weight = frecency_weight;
+	search.frecencies.resize(entries.size());
+	for (size_t i = 0; i < entries.size(); i++) {
+		search.frecencies[i] = entries[i].frecency;
+	}
+
+	search.state.frecencies = search.frecencies.data();
+
+	if (query_history != nullptr) {
+		search.query_history = *query_history;
+		search.state.query_history = &search.query_history;
+	} else {
+		search.state.query_history = nullptr;
+	}
+
+	search.state.latest_generation = &search.latest_generation;
+	search.state.is_valid = false;
+
+	search.arena.capacity = mb_to_bytes(8);
+
+	search.pending_pattern.reserve(RESERVED_PATTERN_LENGTH);
+	search.pending_lang_agnostic_pattern.reserve(RESERVED_PATTERN_LENGTH);
+	search.state.pattern.reserve(RESERVED_PATTERN_LENGTH);
+	search.state.lang_agnostic_pattern.reserve(RESERVED_PATTERN_LENGTH);
+
+	search.is_running = true;
+	search.has_pending_query = false;
+	search.has_completed_result = false;
+	search.has_pending_frecencies = false;
+	search.has_pending_query_history = false;
+	search.pending_frecency_updates.clear();
+
+	search.thread = std::thread(async_search_thread_worker, &search);
+}
+
+void async_search_stop(AsyncSearch& search) {
+	PROFILE_FUNCTION();
+
+	{
+		std::unique_lock lock(search.mutex);
+		search.is_running = false;
+	}
+
+	// Abandon the query that is being executed
+	search.latest_generation.fetch_add(1, std::memory_order::relaxed);
+	search.wake_var.notify_all();
+
+	search.thread.join();
+
+	search_state_release(search.state);
+	arena_release(search.arena);
+}
+
+void async_search_post_query(AsyncSearch& search,
+		std::wstring_view search_pattern,
+		std::wstring_view lang_agnostic_search_pattern) {
+	PROFILE_FUNCTION();
+
+	{
+		std::unique_lock lock(search.mutex);
+		search.pending_pattern = search_pattern;
+		search.pending_lang_agnostic_pattern = lang_agnostic_search_pattern;
+		search.has_pending_query = true;
+
+		search.latest_generation.fetch_add(1, std::memory_order::relaxed);
+	}
+
+	search.wake_var.notify_one();
+}
+
+void async_search_update_entry_frecency(AsyncSearch& search, uint32_t entry_index, float frecency) {
+	std::unique_lock lock(search.mutex);
+	search.pending_frecency_updates.push_back(EntryFrecencyUpdate { entry_index, frecency });
+}
+
+void async_search_update_frecencies(AsyncSearch& search, const std::vector<Entry>& entries) {
+	std::unique_lock lock(search.mutex);
+
+	search.pending_frecencies.resize(entries.size());
+	for (size_t i = 0; i < entries.size(); i++) {
+		search.pending_frecencies[i] = entries[i].frecency;
+	}
+
+	search.has_pending_frecencies = true;
+	search.pending_frecency_updates.clear();
+}
+
+void async_search_update_query_history(AsyncSearch& search, const QueryHistory& query_history) {
+	std::unique_lock lock(search.mutex);
+	search.pending_query_history = query_history;
+	search.has_pending_query_history = true;
+}
+
+bool async_search_take_result(AsyncSearch& search, SearchResult& out_result) {
+	std::unique_lock lock(search.mutex);
+	if (!search.has_completed_result) {
+		return false;
+	}
+
+	std::swap(search.completed_result, out_result);
+	search.has_completed_result = false;
+
+	return true;
+}
@@ -0,0 +1,500 @@
+#pragma once
+
+#include "core.h"
+#include "math.h"
+
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//
+// Launch History
+//
+
+static constexpr uint32_t LAUNCH_HISTORY_BUCKET_COUNT = 16;
+
+// Histogram of the launches of an entry over the last `LAUNCH_HISTORY_BUCKET_COUNT` weeks
+struct LaunchHistory {
+	// Ring of the launch counts, the launches of a `week` are counted in `bucket_counts[week % LAUNCH_HISTORY_BUCKET_COUNT]`
+	uint8_t bucket_counts[LAUNCH_HISTORY_BUCKET_COUNT];
+
+	// The buckets of the weeks after this one still contain the launches of the older weeks
+	uint32_t last_launch_week;
+};
+
+// Number of weeks since the unix epoch
+uint32_t launch_history_get_current_week();
+
+void launch_history_record_launch(LaunchHistory& history, uint32_t current_week, uint32_t count = 1);
+
+// Launch count in which the older launches are weighted less, halving every two weeks
+float launch_history_compute_frecency(const LaunchHistory& history, uint32_t current_week);
+
+struct Entry {
+	std::wstring name;
+	std::filesystem::path path;
+	std::filesystem::path resolved_path;
+
+	// Of the file at the `path` when it was walked, the shortcut is only resolved again after they have changed
+	uint64_t file_write_time;
+	uint64_t file_size;
+
+	bool icon_is_loaded;
+	UVec2 icon;
+
+	const wchar_t* id;
+	bool is_microsoft_store_app;
+
+	// Only set for the Microsoft Store apps, their icon is loaded from it when the entry is displayed
+	std::wstring logo_uri;
+
+	LaunchHistory launch_history;
+
+	// Cached `launch_history_compute_frecency`, so that the search doesn't have to decay the history.
+	// Only updated when the entry is launched and once a week, see `update_frecency_scores`.
+	float frecency;
+};
+
+static constexpr uint32_t HIGHLIGHTS_NOT_COMPUTED = UINT32_MAX;
+
+struct ResultEntry {
+	uint32_t entry_index;
+	uint32_t match_score;
+
+	// The `match_score` combined with the frecency and the query history of the entry, the results are ordered by it
+	float score;
+
+	// Range of the `SearchResult::highlights`, `start` is `HIGHLIGHTS_NOT_COMPUTED`
+	// until the `search_result_compute_highlights` is called for the result
+	RangeU32 highlights;
+};
+
+//
+// Search Corpus
+//
+
+struct SearchIndexBlock;
+
+// Additional fields of the entries, matched when the name of the entry doesn't match the pattern
+enum class SearchField : uint32_t {
+	// Name of the resolved executable without the extension
+	FileName,
+
+	// Name of the folder that contains the resolved executable
+	ParentFolder,
+
+	// Id of the Microsoft Store app
+	PackageId,
+};
+
+static constexpr uint32_t SEARCH_FIELD_COUNT = 3;
+
+// The match score of a field is multiplied by its weight, which is at most 1, so that the matches in the names are preferred.
+// Fields with zero weight are not stored in the corpus.
+struct SearchFieldWeights {
+	float values[SEARCH_FIELD_COUNT];
+};
+
+static constexpr SearchFieldWeights DEFAULT_SEARCH_FIELD_WEIGHTS = { { 0.75f, 0.5f, 0.5f } };
+
+// Optional inverted index from the ordered character pairs to the entries that contain them.
+//
+// A name contains the pair `ab` when `a` occurs anywhere before `b`,
+// so a name that contains the pattern as a subsequence also contains every adjacent pair of the pattern.
+//
+// The pairs are hashed into a fixed number of buckets, which can only produce extra candidates.
+// Entries are split into blocks, which are built in parallel,
+// each bucket of a block stores the delta encoded entry indices.
+struct SearchIndex {
+	Arena arena;
+
+	uint32_t block_count;
+	const SearchIndexBlock* blocks;
+
+	// Number of entries in each bucket across all of the blocks
+	const uint32_t* bucket_entry_counts;
+};
+
+// Case-folded copy of the entry names, stored back to back in a single buffer,
+// so that the matcher scans contiguous memory instead of chasing `Entry::name` allocations.
+//
+// Folding maps every code unit to exactly one code unit,
+// so the indices into a folded name are also valid for the original `Entry::name`.
+//
+// The name of each entry is followed by its enabled fields, together they form the record of the entry.
+struct SearchCorpus {
+	Arena arena;
+
+	uint32_t entry_count;
+	const wchar_t* names;
+	const uint32_t* name_offsets;
+	const uint32_t* name_lengths;
+
+	// Length of the name and all of the fields of the entry
+	const uint32_t* record_lengths;
+
+	// The enabled fields ordered by their weight, which is also the order in which they follow the name
+	uint32_t field_count;
+	SearchField fields[SEARCH_FIELD_COUNT];
+	float field_weights[SEARCH_FIELD_COUNT];
+	const uint32_t* field_lengths[SEARCH_FIELD_COUNT];
+
+	// Set of characters present in each record, see `search_char_mask_bit`.
+	// Aligned to a cache line, so that it can be scanned with SIMD loads.
+	const uint32_t* char_masks;
+
+	// Per character bonus for starting a match at that character (word boundaries, camelCase humps),
+	// computed from the original case of the name. Shares the `name_offsets` with the `names`.
+	const uint8_t* char_bonuses;
+
+	// Folded characters of the name that start a word or a camelCase hump,
+	// so that acronyms like `vsc` for `Visual Studio Code` are matched without scanning the name.
+	const wchar_t* initials;
+	const uint32_t* initial_offsets;
+	const uint32_t* initial_lengths;
+
+	// Only built by the `search_corpus_build_index`
+	SearchIndex index;
+};
+
+// Lowercases the character and strips its diacritics, the result doesn't depend on the locale
+wchar_t search_fold_char(wchar_t c);
+
+// Latin letters get a bit each, the rest of the characters share the remaining 6 bits.
+inline uint32_t search_char_mask_bit(wchar_t folded_char) {
+	if (folded_char >= L'a' && folded_char <= L'z') {
+		return 1u << (uint32_t)(folded_char - L'a');
+	}
+
+	return 1u << (26 + (uint32_t)folded_char % 6);
+}
+
+inline uint32_t search_compute_char_mask(std::wstring_view folded_string) {
+	uint32_t mask = 0;
+	for (wchar_t c : folded_string) {
+		mask |= search_char_mask_bit(c);
+	}
+
+	return mask;
+}
+
+// Writes the folded `string` into `out_buffer`, which must be at least `string.length()` long
+void search_fold_string(std::wstring_view string, wchar_t* out_buffer);
+
+// Rebuilds the corpus from the `entries`, invalidates all the previously returned names and the index
+void search_corpus_build(SearchCorpus& corpus, const std::vector<Entry>& entries, const SearchFieldWeights& field_weights);
+
+// Builds the index of the corpus on the job system and waits for it to complete
+void search_corpus_build_index(SearchCorpus& corpus, Arena& arena, Arena& temp_arena);
+void search_corpus_release(SearchCorpus& corpus);
+
+inline std::wstring_view search_corpus_get_name(const SearchCorpus& corpus, uint32_t entry_index) {
+	assert(entry_index < corpus.entry_count);
+	return std::wstring_view(corpus.names + corpus.name_offsets[entry_index], corpus.name_lengths[entry_index]);
+}
+
+// The name of the entry followed by its fields
+inline std::wstring_view search_corpus_get_record(const SearchCorpus& corpus, uint32_t entry_index) {
+	assert(entry_index < corpus.entry_count);
+	return std::wstring_view(corpus.names + corpus.name_offsets[entry_index], corpus.record_lengths[entry_index]);
+}
+
+inline const uint8_t* search_corpus_get_char_bonuses(const SearchCorpus& corpus, uint32_t entry_index) {
+	assert(entry_index < corpus.entry_count);
+	return corpus.char_bonuses + corpus.name_offsets[entry_index];
+}
+
+inline std::wstring_view search_corpus_get_initials(const SearchCorpus& corpus, uint32_t entry_index) {
+	assert(entry_index < corpus.entry_count);
+	return std::wstring_view(corpus.initials + corpus.initial_offsets[entry_index], corpus.initial_lengths[entry_index]);
+}
+
+//
+// Query History
+//
+
+static constexpr uint32_t QUERY_HISTORY_BUCKET_COUNT = 1024;
+static constexpr uint32_t QUERY_HISTORY_BUCKET_SIZE = 4;
+
+// Only this many of the first pattern characters are remembered
+static constexpr uint32_t MAX_QUERY_HISTORY_PREFIX_LENGTH = 16;
+
+struct QueryHistorySlot {
+	// Hash of the folded pattern prefix
+	uint64_t prefix_hash;
+	uint32_t entry_index;
+
+	// Zero for the empty slots
+	uint32_t launch_count;
+
+	// Value of the `QueryHistory::launch_counter` at the last launch, used for the eviction
+	uint32_t last_launch;
+};
+
+// Remembers which entries were launched after typing a pattern,
+// so that typing a prefix of that pattern again ranks them higher.
+//
+// Set associative table, an association can only be stored in the slots of the bucket selected by its hash,
+// when the bucket is full the least recently launched association of the bucket is evicted.
+struct QueryHistory {
+	uint32_t launch_counter;
+	QueryHistorySlot slots[QUERY_HISTORY_BUCKET_COUNT * QUERY_HISTORY_BUCKET_SIZE];
+};
+
+// Records the launch for every prefix of the folded patterns
+void query_history_record_launch(QueryHistory& history,
+		std::wstring_view folded_pattern,
+		std::wstring_view folded_lang_agnostic_pattern,
+		uint32_t entry_index);
+
+// Restores a slot that was previously read from the `QueryHistory::slots`
+void query_history_restore_slot(QueryHistory& history, const QueryHistorySlot& slot);
+
+// Moves the associations to the new indices of their entries after the entries were replaced.
+// `new_entry_indices[old_index]` is `UINT32_MAX` for the removed entries, their associations are dropped.
+void query_history_remap_entries(QueryHistory& history, Span<const uint32_t> new_entry_indices);
+
+//
+// Searching
+//
+
+static constexpr uint32_t DEFAULT_PARALLEL_SEARCH_THRESHOLD = 16384;
+
+// The index is only built for corpora with at least this many entries
+static constexpr uint32_t DEFAULT_SEARCH_INDEX_THRESHOLD = 65536;
+
+// A match scores roughly 16 points per matched character, see the alignment scoring in the `search.cpp`
+static constexpr float DEFAULT_FRECENCY_WEIGHT = 2.0f;
+
+struct SearchResult {
+	std::vector<ResultEntry> matches;
+
+	// Only contains the highlights of the results that were displayed
+	std::vector<RangeU32> highlights;
+
+	// Folded patterns of the query, needed for computing the highlights
+	std::wstring pattern;
+	std::wstring lang_agnostic_pattern;
+
+	// Only the front of the `matches` is sorted, see `search_sort_results`
+	size_t sorted_count;
+};
+
+static constexpr uint32_t SEARCH_CACHE_CAPACITY = 32;
+
+struct SearchCacheEntry {
+	uint64_t hash;
+	uint64_t last_use;
+
+	// Folded patterns, stored in the cache arena
+	std::wstring_view pattern;
+	std::wstring_view lang_agnostic_pattern;
+
+	// Only the `ResultEntry::match_score` is reused, the frecency and the query history
+	// of the entries are reapplied when the entry is reused
+	Span<ResultEntry> matches;
+};
+
+// LRU cache of the recent query results, so that retyping the same prefix doesn't rescan the entries.
+//
+// The matches are stored in one of the two bounded arenas,
+// when the active one runs out of space the remaining entries are compacted into the other one.
+struct SearchCache {
+	Arena arenas[2];
+	uint32_t active_arena;
+
+	size_t entries_size;
+	size_t corpus_entry_count;
+
+	uint64_t use_counter;
+
+	uint32_t entry_count;
+	SearchCacheEntry entries[SEARCH_CACHE_CAPACITY];
+};
+
+// Keeps the state of the previous query, so that typing more characters
+// only rescans the entries which could still match the whole pattern.
+struct SearchState {
+	// Queries with at least this many candidates are scored on the job system workers
+	uint32_t parallel_search_threshold;
+
+	// Multiplier of the `Entry::frecency` added to the match score
+	float frecency_weight;
+
+	// Optional. Read instead of the `Entry::frecency`, when the entries are updated by another thread
+	const float* frecencies;
+
+	// Optional. Entries launched after typing the same prefix are ranked higher
+	const QueryHistory* query_history;
+
+	// Per query buffers of the scoring chunks
+	Arena scratch_arena;
+
+	// Optional. The query is abandoned as soon as `latest_generation` differs from `generation`
+	const std::atomic_uint64_t* latest_generation;
+	uint64_t generation;
+
+	bool is_valid;
+	size_t entry_count;
+
+	std::wstring pattern;
+	std::wstring lang_agnostic_pattern;
+
+	// Entries that matched every character of at least one of the patterns
+	std::vector<uint32_t> full_match_candidates;
+
+	SearchCache cache;
+
+	// Precomputed result of the empty query, which contains all of the entries ordered by their frecency.
+	// Built by the first empty query, afterwards only the entries whose frecency changed are moved.
+	bool are_ranks_valid;
+	std::vector<ResultEntry> ranked_entries;
+
+	// Position of every entry in the `ranked_entries`
+	std::vector<uint32_t> entry_ranks;
+};
+
+void search_state_release(SearchState& state);
+
+// Moves the entry within the precomputed empty query result, must be called after its frecency has changed
+void search_state_rerank_entry(SearchState& state, const std::vector<Entry>& entries, uint32_t entry_index);
+
+// Discards the precomputed empty query result, which is then rebuilt by the next empty query.
+// Cheaper than reranking the entries one by one after the frecency of most of them has changed.
+void search_state_invalidate_ranks(SearchState& state);
+
+// Writes the indices of the entries that contain every character of
+// at least one of the pattern masks into `out_indices`, returns the number of written indices.
+//
+// `out_indices` must have space for `corpus.entry_count` indices.
+uint32_t search_prefilter(const SearchCorpus& corpus,
+		uint32_t pattern_mask,
+		uint32_t lang_agnostic_pattern_mask,
+		uint32_t* out_indices);
+
+// Writes the indices of the entries which can contain either of the patterns into the `out_indices`
+// in ascending order and their number into the `out_count`.
+//
+// Returns `false` if the corpus has no index or either of the patterns is shorter than a pair,
+// in that case `search_prefilter` must be used instead.
+//
+// `out_indices` must have space for `corpus.entry_count` indices.
+bool search_index_query(const SearchCorpus& corpus,
+		std::wstring_view folded_pattern,
+		std::wstring_view folded_lang_agnostic_pattern,
+		uint32_t* out_indices,
+		uint32_t* out_count,
+		Arena& temp_arena);
+
+// Only the entries that contain either of the patterns as a subsequence are added to the `result`.
+//
+// Only the best results are sorted, use `search_sort_results` before accessing the rest of them.
+//
+// Returns `false` if the query was abandoned, in that case both the `result` and the `search_state` are left untouched.
+bool update_search_result(std::wstring_view search_pattern,
+		std::wstring_view lang_agnostic_search_pattern,
+		const std::vector<Entry>& entries,
+		const SearchCorpus& corpus,
+		SearchState& search_state,
+		SearchResult& result,
+		Arena& arena);
+
+// Makes sure that at least the first `required_count` results are sorted
+void search_sort_results(SearchResult& result, size_t required_count);
+
+// Computes the highlights of the result at `result_index`, unless they are already computed.
+//
+// The highlights are only needed for the displayed results,
+// so they are computed on demand instead of for every match during the query.
+void search_result_compute_highlights(SearchResult& result, size_t result_index, const SearchCorpus& corpus, Arena& temp_arena);
+
+//
+// Async Search
+//
+
+using SearchResultReadyCallback = void(*)(void* user_data);
+
+struct EntryFrecencyUpdate {
+	uint32_t entry_index;
+	float frecency;
+};
+
+// Runs the queries on a dedicated search thread, so that the UI thread never waits for a scan.
+//
+// When several queries are posted while the search thread is busy only the latest one is executed,
+// the query that is being executed is abandoned as soon as a newer one is posted.
+struct AsyncSearch {
+	const std::vector<Entry>* entries;
+	const SearchCorpus* corpus;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake_var;
+
+	// Called on the search thread, after a new result becomes available
+	SearchResultReadyCallback result_ready_callback;
+	void* callback_user_data;
+
+	std::atomic_uint64_t latest_generation;
+
+	// Protected by the `mutex`
+	bool is_running;
+	bool has_pending_query;
+	std::wstring pending_pattern;
+	std::wstring pending_lang_agnostic_pattern;
+
+	bool has_completed_result;
+	SearchResult completed_result;
+
+	bool has_pending_frecencies;
+	std::vector<float> pending_frecencies;
+	std::vector<EntryFrecencyUpdate> pending_frecency_updates;
+
+	bool has_pending_query_history;
+	QueryHistory pending_query_history;
+
+	// Owned by the search thread
+	SearchState state;
+	SearchResult working_result;
+	Arena arena;
+
+	// Copies of the `Entry::frecency` and the query history, which are updated by the main thread
+	std::vector<float> frecencies;
+	QueryHistory query_history;
+};
+
+// The `entries` and the `corpus` must not be rebuilt while the search is running.
+// The `query_history` is optional, the search copies it and the frecency of the entries, their updates have to be posted.
+void async_search_start(AsyncSearch& search,
+		const std::vector<Entry>& entries,
+		const SearchCorpus& corpus,
+		const QueryHistory* query_history,
+		uint32_t parallel_search_threshold,
+		float frecency_weight,
+		SearchResultReadyCallback result_ready_callback,
+		void* callback_user_data);
+
+void async_search_stop(AsyncSearch& search);
+
+// Replaces any pending query, never blocks on the query that is being executed
+void async_search_post_query(AsyncSearch& search,
+		std::wstring_view search_pattern,
+		std::wstring_view lang_agnostic_search_pattern);
+
+// The updates are applied by the search thread right before it executes the next query.
+//
+// Updating a single entry moves it within the ranks, see `search_state_rerank_entry`.
+// Updating all of them invalidates the ranks instead, see `search_state_invalidate_ranks`.
+void async_search_update_entry_frecency(AsyncSearch& search, uint32_t entry_index, float frecency);
+void async_search_update_frecencies(AsyncSearch& search, const std::vector<Entry>& entries);
+void async_search_update_query_history(AsyncSearch& search, const QueryHistory& query_history);
+
+// Swaps the newest completed result into the `out_result`.
+//
+// Returns `false` if there is no result newer than the previously taken one.
+bool async_search_take_result(AsyncSearch& search, SearchResult& out_result);
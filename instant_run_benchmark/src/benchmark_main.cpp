@@ -0,0 +1,811 @@
+#include "core.h"
+#include "log.h"
+#include "job_system.h"
+#include "search.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <clocale>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <new>
+
+// Headless benchmark of the search, replays the typing of the queries through `update_search_result`
+// and reports the latency and the heap allocations of every keystroke and the ranking quality of the queries.
+//
+// Only links the search and its dependencies, so it builds on the platforms without the window and the renderer.
+//
+// Usage: search_benchmark [options]
+//     --corpus <path>          Names of the entries, one per line, optionally followed by a tab and the resolved path.
+//                              Synthetic corpora of the `--sizes` are generated when not provided.
+//     --queries <path>         Queries, one per line, optionally followed by a tab and the name of the expected entry.
+//                              Generated from the names of random entries when not provided.
+//     --sizes <n,n,...>        Entry counts of the synthetic corpora, defaults to 10000,100000,1000000
+//     --query-count <n>        Number of the generated queries, defaults to 200
+//     --seed <n>               Seed of the synthetic corpora and the generated queries
+//     --workers <n>            Number of the job system workers, defaults to the hardware concurrency - 1
+//     --max-p99-ms <ms>        Fails when the p99 keystroke latency of any corpus is above this
+//     --min-mrr <value>        Fails when the mean reciprocal rank of any corpus is below this
+//     --max-allocations <n>    Fails when any keystroke after the first query allocates more than this.
+//                              The first query grows the reused result and state buffers to their capacity.
+
+// The app displays about this many results, they are sorted and highlighted by every keystroke
+static constexpr size_t DISPLAYED_RESULT_COUNT = 10;
+
+// The expected entry only counts towards the mean reciprocal rank when it is in this many of the first results
+static constexpr size_t MAX_RANKED_RESULT_COUNT = 10;
+
+static constexpr size_t DEFAULT_QUERY_COUNT = 200;
+static constexpr uint64_t DEFAULT_SEED = 1;
+static constexpr size_t DEFAULT_CORPUS_SIZES[] = { 10000, 100000, 1000000 };
+
+static constexpr size_t RESERVED_PATTERN_LENGTH = 128;
+
+//
+// Allocation Tracking
+//
+
+// Every heap allocation of the process, including the ones on the job system workers
+static std::atomic_uint64_t s_allocation_count;
+
+void* operator new(size_t size) {
+	s_allocation_count.fetch_add(1, std::memory_order::relaxed);
+
+	void* allocation = malloc(size > 0 ? size : 1);
+	if (allocation == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	return allocation;
+}
+
+void operator delete(void* allocation) noexcept {
+	free(allocation);
+}
+
+void operator delete(void* allocation, [[maybe_unused]] size_t size) noexcept {
+	free(allocation);
+}
+
+//
+// Platform
+//
+
+// NOTE: The `platform.cpp` is not linked, because it depends on the window system.
+// The job system workers only need these, the workers are left to the OS scheduler.
+
+void platform_initialize_thread() {}
+void platform_shutdown_thread() {}
+void platform_set_this_thread_affinity_mask([[maybe_unused]] uint64_t mask) {}
+
+//
+// Corpus
+//
+
+struct BenchmarkQuery {
+	std::wstring pattern;
+
+	// Empty for the queries which only measure the latency
+	std::wstring expected_name;
+};
+
+static const wchar_t* const VENDOR_WORDS[] = {
+	L"Microsoft", L"Adobe", L"Google", L"Mozilla", L"JetBrains", L"Oracle", L"Autodesk", L"Valve",
+	L"Blender", L"Docker", L"Epic", L"Logitech", L"NVIDIA", L"Intel", L"Realtek", L"Python",
+	L"Git", L"Zoom", L"Slack", L"Discord", L"Spotify", L"VideoLAN", L"Notepad++", L"7-Zip",
+	L"Unity", L"Corsair", L"Razer", L"Dell", L"Lenovo", L"Kingston", L"OBS", L"Wireshark",
+};
+
+static const wchar_t* const PRODUCT_WORDS[] = {
+	L"Visual", L"Studio", L"Code", L"Office", L"Word", L"Excel", L"PowerPoint", L"Outlook",
+	L"Teams", L"Edge", L"Chrome", L"Firefox", L"Thunderbird", L"Photoshop", L"Illustrator", L"Premiere",
+	L"Acrobat", L"Reader", L"Terminal", L"Explorer", L"Manager", L"Settings", L"Control", L"Panel",
+	L"Device", L"Driver", L"Update", L"Installer", L"Uninstall", L"Help", L"Documentation", L"Console",
+	L"Editor", L"Player", L"Recorder", L"Viewer", L"Browser", L"Client", L"Server", L"Monitor",
+	L"Center", L"Assistant", L"Tools", L"Debugger", L"Profiler", L"Launcher", L"Calculator", L"Notepad",
+	L"Paint", L"Camera", L"Photos", L"Music", L"Video", L"Mail", L"Calendar", L"Maps",
+	L"Weather", L"Store", L"Security", L"Backup", L"Sync", L"Remote", L"Desktop", L"Connection",
+	L"Network", L"Audio", L"Graphics", L"Shell", L"Command", L"Prompt", L"Package", L"Workbench",
+	L"Designer", L"Builder", L"Toolkit", L"Runtime", L"SDK", L"Compiler", L"Shader", L"Engine",
+	L"Configuration", L"Diagnostics", L"Recovery", L"Keyboard", L"Mouse", L"Display", L"Sound", L"Capture",
+};
+
+static const wchar_t* const VERSION_SUFFIXES[] = {
+	L"2019", L"2022", L"12", L"3.11", L"x64", L"(x86)", L"Preview", L"Beta",
+};
+
+template<typename T, size_t N>
+static const T& pick_random(const T (&values)[N], std::mt19937_64& rng) {
+	return values[rng() % N];
+}
+
+// Names are made of an optional vendor, one to three product words and an optional version,
+// the resolved path is `/opt/<vendor>/<name>/<product word>.exe`, so that the fields can match too.
+static void generate_synthetic_corpus(size_t entry_count, std::mt19937_64& rng, std::vector<Entry>& out_entries) {
+	PROFILE_FUNCTION();
+
+	out_entries.clear();
+	out_entries.resize(entry_count);
+
+	for (size_t i = 0; i < entry_count; i++) {
+		Entry& entry = out_entries[i];
+
+		std::wstring vendor = rng() % 2 == 0 ? pick_random(VENDOR_WORDS, rng) : L"Common";
+		std::wstring executable_name = pick_random(PRODUCT_WORDS, rng);
+
+		std::wstring name;
+		if (vendor != L"Common") {
+			name = vendor;
+		}
+
+		uint32_t product_word_count = 1 + (uint32_t)(rng() % 3);
+		for (uint32_t j = 0; j < product_word_count; j++) {
+			if (!name.empty()) {
+				name += L' ';
+			}
+
+			name += j == 0 ? executable_name : pick_random(PRODUCT_WORDS, rng);
+		}
+
+		if (rng() % 4 == 0) {
+			name += L' ';
+			name += pick_random(VERSION_SUFFIXES, rng);
+		}
+
+		entry.resolved_path = std::filesystem::path(L"/opt") / vendor / name / (executable_name + L".exe");
+		entry.path = entry.resolved_path;
+		entry.name = std::move(name);
+	}
+}
+
+// Returns the non-empty lines of the text file, without the line breaks, the lines are stored in the `arena`
+static bool read_file_lines(const std::filesystem::path& path, Arena& arena, std::vector<std::string_view>& out_lines) {
+	std::string_view content;
+	if (!read_text_file(path, arena, &content)) {
+		return false;
+	}
+
+	size_t line_start = 0;
+	while (line_start < content.length()) {
+		size_t line_end = content.find('\n', line_start);
+		if (line_end == std::string_view::npos) {
+			line_end = content.length();
+		}
+
+		std::string_view line = content.substr(line_start, line_end - line_start);
+		if (!line.empty() && line.back() == '\r') {
+			line = line.substr(0, line.length() - 1);
+		}
+
+		if (!line.empty()) {
+			out_lines.push_back(line);
+		}
+
+		line_start = line_end + 1;
+	}
+
+	return true;
+}
+
+// Splits the line at the first tab, the `out_second` is empty if there is no tab
+static void split_tab_separated_line(std::string_view line,
+		Arena& arena,
+		std::wstring* out_first,
+		std::wstring* out_second) {
+	size_t separator = line.find('\t');
+
+	*out_first = std::wstring(string_to_wide(line.substr(0, separator), arena));
+	if (separator == std::string_view::npos) {
+		out_second->clear();
+	} else {
+		*out_second = std::wstring(string_to_wide(line.substr(separator + 1), arena));
+	}
+}
+
+static bool load_recorded_corpus(const std::filesystem::path& path, std::vector<Entry>& out_entries, Arena& temp_arena) {
+	PROFILE_FUNCTION();
+
+	ArenaSavePoint temp = arena_begin_temp(temp_arena);
+
+	std::vector<std::string_view> lines;
+	if (!read_file_lines(path, temp_arena, lines)) {
+		arena_end_temp(temp);
+		return false;
+	}
+
+	out_entries.clear();
+	out_entries.resize(lines.size());
+
+	std::wstring resolved_path;
+	for (size_t i = 0; i < lines.size(); i++) {
+		Entry& entry = out_entries[i];
+
+		split_tab_separated_line(lines[i], temp_arena, &entry.name, &resolved_path);
+		entry.resolved_path = resolved_path;
+		entry.path = entry.resolved_path;
+	}
+
+	arena_end_temp(temp);
+	return true;
+}
+
+static bool load_recorded_queries(const std::filesystem::path& path, std::vector<BenchmarkQuery>& out_queries, Arena& temp_arena) {
+	PROFILE_FUNCTION();
+
+	ArenaSavePoint temp = arena_begin_temp(temp_arena);
+
+	std::vector<std::string_view> lines;
+	if (!read_file_lines(path, temp_arena, lines)) {
+		arena_end_temp(temp);
+		return false;
+	}
+
+	out_queries.clear();
+	out_queries.resize(lines.size());
+
+	for (size_t i = 0; i < lines.size(); i++) {
+		BenchmarkQuery& query = out_queries[i];
+		split_tab_separated_line(lines[i], temp_arena, &query.pattern, &query.expected_name);
+	}
+
+	arena_end_temp(temp);
+	return true;
+}
+
+//
+// Query Generation
+//
+
+// How a generated query abbreviates the name of the expected entry
+enum class QueryKind {
+	// "phot" for "Adobe Photoshop"
+	WordPrefix,
+
+	// "vsc" for "Visual Studio Code"
+	Initials,
+
+	// "vistu" for "Visual Studio Code"
+	WordPrefixes,
+
+	// "adph" for "Adobe Photoshop", random characters in order
+	Subsequence,
+};
+
+static constexpr uint32_t QUERY_KIND_COUNT = 4;
+
+static std::vector<std::wstring_view> split_words(std::wstring_view name) {
+	std::vector<std::wstring_view> words;
+
+	size_t word_start = 0;
+	while (word_start < name.length()) {
+		size_t word_end = name.find(L' ', word_start);
+		if (word_end == std::wstring_view::npos) {
+			word_end = name.length();
+		}
+
+		if (word_end > word_start) {
+			words.push_back(name.substr(word_start, word_end - word_start));
+		}
+
+		word_start = word_end + 1;
+	}
+
+	return words;
+}
+
+static void append_lowercase(std::wstring& string, std::wstring_view value) {
+	for (wchar_t c : value) {
+		string += (wchar_t)std::towlower(c);
+	}
+}
+
+static std::wstring generate_query(std::wstring_view name, QueryKind kind, std::mt19937_64& rng) {
+	std::vector<std::wstring_view> words = split_words(name);
+	if (words.empty()) {
+		return {};
+	}
+
+	if (words.size() == 1 && (kind == QueryKind::Initials || kind == QueryKind::WordPrefixes)) {
+		kind = QueryKind::WordPrefix;
+	}
+
+	std::wstring query;
+	switch (kind) {
+	case QueryKind::WordPrefix: {
+		std::wstring_view word = words[rng() % words.size()];
+		size_t length = min((size_t)(2 + rng() % 4), word.length());
+
+		append_lowercase(query, word.substr(0, length));
+		break;
+	}
+	case QueryKind::Initials:
+		for (std::wstring_view word : words) {
+			append_lowercase(query, word.substr(0, 1));
+		}
+		break;
+	case QueryKind::WordPrefixes: {
+		size_t second_word = 1 + rng() % (words.size() - 1);
+
+		append_lowercase(query, words[0].substr(0, 2 + rng() % 2));
+		append_lowercase(query, words[second_word].substr(0, 2));
+		break;
+	}
+	case QueryKind::Subsequence: {
+		std::vector<size_t> positions;
+		for (size_t i = 0; i < name.length(); i++) {
+			if (name[i] != L' ') {
+				positions.push_back(i);
+			}
+		}
+
+		std::shuffle(positions.begin(), positions.end(), rng);
+		positions.resize(min((size_t)(3 + rng() % 4), positions.size()));
+		std::sort(positions.begin(), positions.end());
+
+		for (size_t position : positions) {
+			append_lowercase(query, name.substr(position, 1));
+		}
+		break;
+	}
+	}
+
+	return query;
+}
+
+// Abbreviates the names of random entries, each query expects the entry whose name it was generated from
+static void generate_labelled_queries(const std::vector<Entry>& entries,
+		size_t query_count,
+		std::mt19937_64& rng,
+		std::vector<BenchmarkQuery>& out_queries) {
+	PROFILE_FUNCTION();
+
+	out_queries.clear();
+	if (entries.empty()) {
+		return;
+	}
+
+	for (size_t i = 0; i < query_count; i++) {
+		const Entry& entry = entries[rng() % entries.size()];
+		QueryKind kind = (QueryKind)(i % QUERY_KIND_COUNT);
+
+		std::wstring pattern = generate_query(entry.name, kind, rng);
+		if (pattern.empty()) {
+			continue;
+		}
+
+		out_queries.push_back(BenchmarkQuery { .pattern = std::move(pattern), .expected_name = entry.name });
+	}
+}
+
+//
+// Benchmark
+//
+
+struct BenchmarkReport {
+	size_t entry_count;
+	double corpus_build_time;
+	double index_build_time;
+
+	// Milliseconds per keystroke
+	std::vector<double> latencies;
+	std::vector<uint64_t> allocation_counts;
+
+	// The keystrokes of the first query, whose allocations aren't checked by the `--max-allocations`
+	size_t warm_up_keystroke_count;
+
+	size_t labelled_query_count;
+	size_t top_result_count;
+	double reciprocal_rank_sum;
+};
+
+static double get_elapsed_milliseconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Same work as the app does for a keystroke, without the drawing.
+// Also includes the heap allocations of the job system workers.
+static void run_keystroke(std::wstring_view pattern,
+		const std::vector<Entry>& entries,
+		const SearchCorpus& corpus,
+		SearchState& state,
+		SearchResult& result,
+		Arena& arena,
+		Arena& temp_arena,
+		BenchmarkReport& report) {
+	ArenaSavePoint temp = arena_begin_temp(arena);
+	ArenaSavePoint highlights_temp = arena_begin_temp(temp_arena);
+
+	uint64_t allocation_count = s_allocation_count.load(std::memory_order::relaxed);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	update_search_result(pattern, pattern, entries, corpus, state, result, arena);
+	search_sort_results(result, DISPLAYED_RESULT_COUNT);
+
+	size_t displayed_count = min(DISPLAYED_RESULT_COUNT, result.matches.size());
+	for (size_t i = 0; i < displayed_count; i++) {
+		search_result_compute_highlights(result, i, corpus, temp_arena);
+	}
+
+	double latency = get_elapsed_milliseconds(start);
+	uint64_t keystroke_allocation_count = s_allocation_count.load(std::memory_order::relaxed) - allocation_count;
+
+	// NOTE: The report is only appended after the allocations were counted, its capacity is reserved anyway
+	report.latencies.push_back(latency);
+	report.allocation_counts.push_back(keystroke_allocation_count);
+
+	arena_end_temp(highlights_temp);
+	arena_end_temp(temp);
+}
+
+// Returns the 1-based rank of the first result named `expected_name`, or 0 if it isn't in the first `MAX_RANKED_RESULT_COUNT`
+static size_t find_expected_rank(SearchResult& result, const std::vector<Entry>& entries, std::wstring_view expected_name) {
+	search_sort_results(result, MAX_RANKED_RESULT_COUNT);
+
+	size_t ranked_count = min(MAX_RANKED_RESULT_COUNT, result.matches.size());
+	for (size_t i = 0; i < ranked_count; i++) {
+		if (entries[result.matches[i].entry_index].name == expected_name) {
+			return i + 1;
+		}
+	}
+
+	return 0;
+}
+
+// Types every query one character at a time and then erases it, so that the incremental search
+// and the search cache are exercised the same way as in the app.
+static BenchmarkReport run_benchmark(const std::vector<Entry>& entries,
+		const std::vector<BenchmarkQuery>& queries,
+		Arena& arena,
+		Arena& temp_arena) {
+	PROFILE_FUNCTION();
+
+	BenchmarkReport report{};
+	report.entry_count = entries.size();
+
+	size_t keystroke_count = 0;
+	for (const BenchmarkQuery& query : queries) {
+		keystroke_count += query.pattern.length() * 2;
+	}
+
+	report.latencies.reserve(keystroke_count);
+	report.allocation_counts.reserve(keystroke_count);
+
+	SearchCorpus corpus{};
+
+	// The default capacity only fits the corpora of a typical installation
+	corpus.arena.capacity = mb_to_bytes(4096);
+
+	std::chrono::steady_clock::time_point build_start = std::chrono::steady_clock::now();
+	search_corpus_build(corpus, entries, DEFAULT_SEARCH_FIELD_WEIGHTS);
+	report.corpus_build_time = get_elapsed_milliseconds(build_start);
+
+	if (corpus.entry_count >= DEFAULT_SEARCH_INDEX_THRESHOLD) {
+		std::chrono::steady_clock::time_point index_start = std::chrono::steady_clock::now();
+		search_corpus_build_index(corpus, arena, temp_arena);
+		report.index_build_time = get_elapsed_milliseconds(index_start);
+	}
+
+	SearchState state{};
+	state.parallel_search_threshold = DEFAULT_PARALLEL_SEARCH_THRESHOLD;
+	state.frecency_weight = DEFAULT_FRECENCY_WEIGHT;
+	state.pattern.reserve(RESERVED_PATTERN_LENGTH);
+	state.lang_agnostic_pattern.reserve(RESERVED_PATTERN_LENGTH);
+
+	SearchResult result{};
+
+	Arena query_arena{};
+	query_arena.capacity = mb_to_bytes(64);
+
+	for (const BenchmarkQuery& query : queries) {
+		std::wstring_view pattern = query.pattern;
+
+		for (size_t length = 1; length <= pattern.length(); length++) {
+			run_keystroke(pattern.substr(0, length), entries, corpus, state, result, query_arena, temp_arena, report);
+		}
+
+		if (!query.expected_name.empty()) {
+			size_t rank = find_expected_rank(result, entries, query.expected_name);
+
+			report.labelled_query_count += 1;
+			if (rank == 1) {
+				report.top_result_count += 1;
+			}
+
+			if (rank != 0) {
+				report.reciprocal_rank_sum += 1.0 / (double)rank;
+			}
+		}
+
+		for (size_t length = pattern.length(); length > 0; length--) {
+			run_keystroke(pattern.substr(0, length - 1), entries, corpus, state, result, query_arena, temp_arena, report);
+		}
+
+		if (report.warm_up_keystroke_count == 0) {
+			report.warm_up_keystroke_count = report.latencies.size();
+		}
+	}
+
+	arena_release(query_arena);
+	search_state_release(state);
+	search_corpus_release(corpus);
+
+	return report;
+}
+
+static double compute_percentile(std::vector<double>& sorted_values, double percentile) {
+	if (sorted_values.empty()) {
+		return 0.0;
+	}
+
+	size_t index = (size_t)(percentile * (double)(sorted_values.size() - 1) + 0.5);
+	return sorted_values[index];
+}
+
+static double get_mean_reciprocal_rank(const BenchmarkReport& report) {
+	if (report.labelled_query_count == 0) {
+		return 0.0;
+	}
+
+	return report.reciprocal_rank_sum / (double)report.labelled_query_count;
+}
+
+static double get_p99_latency(const BenchmarkReport& report) {
+	std::vector<double> sorted_latencies = report.latencies;
+	std::sort(sorted_latencies.begin(), sorted_latencies.end());
+	return compute_percentile(sorted_latencies, 0.99);
+}
+
+// The most allocations of a single keystroke after the first query
+static uint64_t get_max_allocation_count_after_warm_up(const BenchmarkReport& report) {
+	uint64_t max_allocation_count = 0;
+	for (size_t i = report.warm_up_keystroke_count; i < report.allocation_counts.size(); i++) {
+		max_allocation_count = std::max(max_allocation_count, report.allocation_counts[i]);
+	}
+
+	return max_allocation_count;
+}
+
+static void print_report(const BenchmarkReport& report, const char* corpus_kind) {
+	std::vector<double> sorted_latencies = report.latencies;
+	std::sort(sorted_latencies.begin(), sorted_latencies.end());
+
+	uint64_t total_allocation_count = 0;
+	uint64_t max_allocation_count = 0;
+	for (uint64_t count : report.allocation_counts) {
+		total_allocation_count += count;
+		max_allocation_count = std::max(max_allocation_count, count);
+	}
+
+	size_t keystroke_count = report.latencies.size();
+	double mean_allocation_count = keystroke_count > 0 ? (double)total_allocation_count / (double)keystroke_count : 0.0;
+
+	printf("corpus: %zu entries (%s), build %.2f ms, index %.2f ms\n",
+			report.entry_count,
+			corpus_kind,
+			report.corpus_build_time,
+			report.index_build_time);
+
+	printf("  latency: %zu keystrokes, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+			keystroke_count,
+			compute_percentile(sorted_latencies, 0.5),
+			compute_percentile(sorted_latencies, 0.99),
+			sorted_latencies.empty() ? 0.0 : sorted_latencies.back());
+
+	printf("  allocations per keystroke: mean %.2f, max %llu, max after the first query %llu\n",
+			mean_allocation_count,
+			(unsigned long long)max_allocation_count,
+			(unsigned long long)get_max_allocation_count_after_warm_up(report));
+
+	if (report.labelled_query_count > 0) {
+		printf("  ranking: MRR@%zu %.3f, top result %.3f over %zu queries\n",
+				MAX_RANKED_RESULT_COUNT,
+				get_mean_reciprocal_rank(report),
+				(double)report.top_result_count / (double)report.labelled_query_count,
+				report.labelled_query_count);
+	}
+
+	fflush(stdout);
+}
+
+//
+// Options
+//
+
+struct BenchmarkOptions {
+	const char* corpus_path;
+	const char* queries_path;
+
+	std::vector<size_t> corpus_sizes;
+	size_t query_count;
+	uint64_t seed;
+	uint32_t worker_count;
+
+	// Regression thresholds, ignored when negative
+	double max_p99_latency;
+	double min_mean_reciprocal_rank;
+	int64_t max_allocation_count;
+};
+
+static bool parse_corpus_sizes(const char* value, std::vector<size_t>& out_sizes) {
+	out_sizes.clear();
+
+	const char* cursor = value;
+	while (*cursor != '\0') {
+		char* end = nullptr;
+		unsigned long long size = strtoull(cursor, &end, 10);
+		if (end == cursor || size == 0) {
+			return false;
+		}
+
+		out_sizes.push_back((size_t)size);
+
+		cursor = end;
+		if (*cursor == ',') {
+			cursor += 1;
+		} else if (*cursor != '\0') {
+			return false;
+		}
+	}
+
+	return !out_sizes.empty();
+}
+
+static bool parse_options(int argc, char** argv, BenchmarkOptions& out_options) {
+	for (int i = 1; i < argc; i++) {
+		std::string_view option = argv[i];
+		if (i + 1 >= argc) {
+			fprintf(stderr, "missing value of the option '%s'\n", argv[i]);
+			return false;
+		}
+
+		const char* value = argv[i + 1];
+		i += 1;
+
+		if (option == "--corpus") {
+			out_options.corpus_path = value;
+		} else if (option == "--queries") {
+			out_options.queries_path = value;
+		} else if (option == "--sizes") {
+			if (!parse_corpus_sizes(value, out_options.corpus_sizes)) {
+				fprintf(stderr, "invalid corpus sizes '%s'\n", value);
+				return false;
+			}
+		} else if (option == "--query-count") {
+			out_options.query_count = (size_t)strtoull(value, nullptr, 10);
+		} else if (option == "--seed") {
+			out_options.seed = (uint64_t)strtoull(value, nullptr, 10);
+		} else if (option == "--workers") {
+			out_options.worker_count = (uint32_t)strtoul(value, nullptr, 10);
+		} else if (option == "--max-p99-ms") {
+			out_options.max_p99_latency = strtod(value, nullptr);
+		} else if (option == "--min-mrr") {
+			out_options.min_mean_reciprocal_rank = strtod(value, nullptr);
+		} else if (option == "--max-allocations") {
+			out_options.max_allocation_count = (int64_t)strtoll(value, nullptr, 10);
+		} else {
+			fprintf(stderr, "unknown option '%s'\n", argv[i - 1]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Returns whether the report is within the regression thresholds
+static bool check_report(const BenchmarkReport& report, const BenchmarkOptions& options) {
+	bool is_passing = true;
+
+	double p99_latency = get_p99_latency(report);
+	if (options.max_p99_latency >= 0.0 && p99_latency > options.max_p99_latency) {
+		fprintf(stderr, "p99 latency %.3f ms is above %.3f ms\n", p99_latency, options.max_p99_latency);
+		is_passing = false;
+	}
+
+	double mean_reciprocal_rank = get_mean_reciprocal_rank(report);
+	if (options.min_mean_reciprocal_rank >= 0.0
+			&& report.labelled_query_count > 0
+			&& mean_reciprocal_rank < options.min_mean_reciprocal_rank) {
+		fprintf(stderr, "MRR %.3f is below %.3f\n", mean_reciprocal_rank, options.min_mean_reciprocal_rank);
+		is_passing = false;
+	}
+
+	uint64_t max_allocation_count = get_max_allocation_count_after_warm_up(report);
+	if (options.max_allocation_count >= 0 && max_allocation_count > (uint64_t)options.max_allocation_count) {
+		fprintf(stderr,
+				"%llu allocations per keystroke are above %lld\n",
+				(unsigned long long)max_allocation_count,
+				(long long)options.max_allocation_count);
+		is_passing = false;
+	}
+
+	return is_passing;
+}
+
+int main(int argc, char** argv) {
+	BenchmarkOptions options{};
+	options.corpus_sizes.assign(std::begin(DEFAULT_CORPUS_SIZES), std::end(DEFAULT_CORPUS_SIZES));
+	options.query_count = DEFAULT_QUERY_COUNT;
+	options.seed = DEFAULT_SEED;
+	options.worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	options.max_p99_latency = -1.0;
+	options.min_mean_reciprocal_rank = -1.0;
+	options.max_allocation_count = -1;
+
+	if (!parse_options(argc, argv, options)) {
+		return EXIT_FAILURE;
+	}
+
+	// The corpus and the query files are UTF-8
+	if (setlocale(LC_CTYPE, "C.UTF-8") == nullptr) {
+		setlocale(LC_CTYPE, "");
+	}
+
+	query_system_memory_spec();
+
+	Arena arena{};
+	arena.capacity = mb_to_bytes(1024);
+
+	Arena temp_arena{};
+	temp_arena.capacity = mb_to_bytes(1024);
+
+	// NOTE: Without a log file and the stdout output the messages are dropped,
+	// the job system logs from its workers, so the logger still has to be initialized.
+	log_init({}, false);
+	log_init_thread(arena, "main");
+
+	job_system_init(max(options.worker_count, 1u));
+
+	std::mt19937_64 rng(options.seed);
+
+	std::vector<Entry> entries;
+	std::vector<BenchmarkQuery> queries;
+
+	bool has_recorded_queries = options.queries_path != nullptr;
+	if (has_recorded_queries && !load_recorded_queries(options.queries_path, queries, temp_arena)) {
+		fprintf(stderr, "failed to read the queries from '%s'\n", options.queries_path);
+		return EXIT_FAILURE;
+	}
+
+	bool is_passing = true;
+	if (options.corpus_path != nullptr) {
+		if (!load_recorded_corpus(options.corpus_path, entries, temp_arena)) {
+			fprintf(stderr, "failed to read the corpus from '%s'\n", options.corpus_path);
+			return EXIT_FAILURE;
+		}
+
+		if (!has_recorded_queries) {
+			generate_labelled_queries(entries, options.query_count, rng, queries);
+		}
+
+		BenchmarkReport report = run_benchmark(entries, queries, arena, temp_arena);
+		print_report(report, "recorded");
+		is_passing = check_report(report, options);
+	} else {
+		for (size_t corpus_size : options.corpus_sizes) {
+			generate_synthetic_corpus(corpus_size, rng, entries);
+
+			if (!has_recorded_queries) {
+				generate_labelled_queries(entries, options.query_count, rng, queries);
+			}
+
+			BenchmarkReport report = run_benchmark(entries, queries, arena, temp_arena);
+			print_report(report, "synthetic");
+			is_passing = check_report(report, options) && is_passing;
+		}
+	}
+
+	job_system_shutdown();
+
+	log_shutdown_thread();
+	log_shutdown();
+
+	arena_release(temp_arena);
+	arena_release(arena);
+
+	return is_passing ? EXIT_SUCCESS : EXIT_FAILURE;
+}
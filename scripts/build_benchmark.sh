@@ -0,0 +1,26 @@
+#!/bin/sh
+
+# Builds the headless search benchmark, it doesn't need the window, the renderer or the vendor libraries.
+
+PLATFORM=linux
+ARCH=$(uname -m)
+APP_NAME=search_benchmark
+SRC=instant_run/src
+
+FILES="instant_run_benchmark/src/benchmark_main.cpp $SRC/core.cpp $SRC/log.cpp $SRC/job_system.cpp $SRC/search.cpp"
+
+if [ "$1" = "release" ]; then
+	CMD_ARGS="-O3 -DBUILD_RELEASE"
+	BIN_DIR=bin/release_${PLATFORM}_${ARCH}
+else
+	CMD_ARGS="-g -DBUILD_DEBUG"
+	BIN_DIR=bin/debug_${PLATFORM}_${ARCH}
+fi
+
+mkdir -p $BIN_DIR
+
+${CXX:-clang++} \
+	$FILES \
+	-I$SRC \
+	-o $BIN_DIR/$APP_NAME \
+	-std=c++20 -pthread $CMD_ARGS